@@ -0,0 +1,9 @@
+#include "appsettings.h"
+
+#include <QCoreApplication>
+
+QSettings &appSettings() {
+    static QSettings settings(QCoreApplication::applicationDirPath() + "/weld_station.ini",
+                              QSettings::IniFormat);
+    return settings;
+}
@@ -0,0 +1,10 @@
+#ifndef APPSETTINGS_H
+#define APPSETTINGS_H
+
+#include <QSettings>
+
+// Station settings, read from weld_station.ini next to the executable.
+// Missing keys fall back to the defaults given at each call site.
+QSettings &appSettings();
+
+#endif // APPSETTINGS_H
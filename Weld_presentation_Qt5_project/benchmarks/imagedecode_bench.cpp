@@ -0,0 +1,127 @@
+// Times ImageLoader's reduced decode (QImageReader::setScaledSize, then a
+// smooth resample) against the full decode and scaled() that the image
+// label used before, and reports each one's peak memory. Each way runs in
+// a process of its own, so the peak RSS of one does not hide the other's.
+// Best of 5 loads; the cache tiers are off, so every load reads and decodes.
+//
+// usage: imagedecode_bench file.jpg [label width, label height; default 1280 960]
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+#include <QProcess>
+#include <QStringList>
+
+#include <cstdio>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "imageloader.h"
+
+namespace {
+
+const int kRuns = 5;
+
+long peakRssKb()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss;  // kilobytes on Linux
+#endif
+    return -1;
+}
+
+// The way the label was filled before ImageLoader: every pixel decoded, then scaled down
+QImage fullDecode(const QString &path, const QSize &labelSize)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+    QByteArray bytes = file.readAll();
+    QBuffer buffer(&bytes);
+    QImage image = QImageReader(&buffer).read();
+    if (image.isNull())
+        return QImage();
+    return image.scaled(ImageLoader::displaySize(image.size(), labelSize), Qt::KeepAspectRatio,
+                        Qt::SmoothTransformation);
+}
+
+QImage reducedDecode(ImageLoader &loader, const QString &path, const QSize &labelSize)
+{
+    QImage result;
+    QEventLoop loop;
+    QObject::connect(&loader, &ImageLoader::imageLoaded, &loop, [&](const ImageRequest &, const QImage &image) {
+        result = image;
+        loop.quit();
+    });
+    QObject::connect(&loader, &ImageLoader::imageFailed, &loop, &QEventLoop::quit);
+    loader.load(path, 0, labelSize);
+    loop.exec();
+    QObject::disconnect(&loader, nullptr, &loop, nullptr);
+    return result;
+}
+
+int runOne(const QString &mode, const QString &path, const QSize &labelSize)
+{
+    ImageLoader loader(0, 0);
+    double bestMs = -1;
+    QSize shown;
+    for (int run = 0; run < kRuns; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        QImage image = mode == "reduced" ? reducedDecode(loader, path, labelSize) : fullDecode(path, labelSize);
+        const double ms = timer.nsecsElapsed() / 1e6;
+        if (image.isNull()) {
+            std::printf("could not decode %s\n", qPrintable(path));
+            return 1;
+        }
+        shown = image.size();
+        if (bestMs < 0 || ms < bestMs)
+            bestMs = ms;
+    }
+    std::printf("  %-8s %8.1f ms   peak RSS %7.1f MB   shown at %dx%d\n", qPrintable(mode), bestMs,
+                peakRssKb() / 1024.0, shown.width(), shown.height());
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+    QString mode;
+    if (args.size() >= 2 && args.at(0) == "--mode") {
+        mode = args.at(1);
+        args = args.mid(2);
+    }
+    if (args.isEmpty()) {
+        std::printf("usage: imagedecode_bench file.jpg [label width, label height]\n");
+        return 1;
+    }
+    const QString path = args.at(0);
+    const QSize labelSize = args.size() >= 3 ? QSize(args.at(1).toInt(), args.at(2).toInt()) : QSize(1280, 960);
+
+    if (!mode.isEmpty())
+        return runOne(mode, path, labelSize);
+
+    const QSize fullSize = QImageReader(path).size();
+    std::printf("%s, %dx%d, label %dx%d\n", qPrintable(path), fullSize.width(), fullSize.height(),
+                labelSize.width(), labelSize.height());
+    std::fflush(stdout);
+    for (const char *each : {"full", "reduced"}) {
+        QProcess child;
+        child.setProcessChannelMode(QProcess::ForwardedChannels);
+        child.start(app.applicationFilePath(), QStringList{"--mode", each} + args);
+        if (!child.waitForFinished(-1) || child.exitCode() != 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Times libjpeg decoding at 1/1, 1/2, 1/4 and 1/8 scale (scale_denom),
+// which is what ImageLoader gets from QImageReader::setScaledSize().
+// Best of 5 runs per scale on one core.
+//
+// usage: jpegscale_bench [file.jpg]
+// Without a file it encodes a synthetic 5472x3648 (20 MP) q90 capture.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <jpeglib.h>
+
+namespace {
+
+const int kRuns = 5;
+
+std::vector<unsigned char> syntheticJpeg(int width, int height)
+{
+    // Blocky gradients with a little noise, so entropy decoding has real work to do
+    std::vector<unsigned char> pixels(size_t(width) * height * 3);
+    unsigned seed = 1;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1103515245u + 12345u;
+            const int noise = (seed >> 24) & 15;
+            const int value = ((x / 7) ^ (y / 5)) & 255;
+            unsigned char *pixel = pixels.data() + (size_t(y) * width + x) * 3;
+            pixel[0] = (unsigned char)(value + noise);
+            pixel[1] = (unsigned char)((value * 3 + y) / 4 + noise);
+            pixel[2] = (unsigned char)((x + y) / 64 + noise);
+        }
+    }
+
+    jpeg_compress_struct compress;
+    jpeg_error_mgr error;
+    compress.err = jpeg_std_error(&error);
+    jpeg_create_compress(&compress);
+    unsigned char *buffer = nullptr;
+    unsigned long length = 0;
+    jpeg_mem_dest(&compress, &buffer, &length);
+    compress.image_width = width;
+    compress.image_height = height;
+    compress.input_components = 3;
+    compress.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&compress);
+    jpeg_set_quality(&compress, 90, TRUE);
+    jpeg_start_compress(&compress, TRUE);
+    while (compress.next_scanline < compress.image_height) {
+        JSAMPROW row = pixels.data() + size_t(compress.next_scanline) * width * 3;
+        jpeg_write_scanlines(&compress, &row, 1);
+    }
+    jpeg_finish_compress(&compress);
+    jpeg_destroy_compress(&compress);
+
+    std::vector<unsigned char> jpeg(buffer, buffer + length);
+    std::free(buffer);
+    return jpeg;
+}
+
+std::vector<unsigned char> readFile(const char *path)
+{
+    std::vector<unsigned char> data;
+    if (FILE *file = std::fopen(path, "rb")) {
+        unsigned char chunk[65536];
+        size_t got;
+        while ((got = std::fread(chunk, 1, sizeof chunk, file)) > 0)
+            data.insert(data.end(), chunk, chunk + got);
+        std::fclose(file);
+    }
+    return data;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    const std::vector<unsigned char> jpeg = argc > 1 ? readFile(argv[1]) : syntheticJpeg(5472, 3648);
+    if (jpeg.empty()) {
+        std::printf("could not read %s\n", argv[1]);
+        return 1;
+    }
+    std::printf("%zu bytes of JPEG\n", jpeg.size());
+
+    for (unsigned denominator = 1; denominator <= 8; denominator *= 2) {
+        double bestMs = 0;
+        size_t decodedBytes = 0;
+        unsigned width = 0, height = 0;
+        for (int run = 0; run < kRuns; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            jpeg_decompress_struct decompress;
+            jpeg_error_mgr error;
+            decompress.err = jpeg_std_error(&error);
+            jpeg_create_decompress(&decompress);
+            jpeg_mem_src(&decompress, const_cast<unsigned char *>(jpeg.data()), (unsigned long)jpeg.size());
+            jpeg_read_header(&decompress, TRUE);
+            decompress.scale_num = 1;
+            decompress.scale_denom = denominator;
+#ifdef JCS_EXTENSIONS
+            decompress.out_color_space = JCS_EXT_BGRX;  // the 32-bit layout QImage decodes into
+#endif
+            jpeg_start_decompress(&decompress);
+            width = decompress.output_width;
+            height = decompress.output_height;
+            const size_t rowBytes = size_t(width) * decompress.output_components;
+            decodedBytes = rowBytes * height;
+            std::vector<unsigned char> decoded(decodedBytes);
+            while (decompress.output_scanline < decompress.output_height) {
+                JSAMPROW row = decoded.data() + decompress.output_scanline * rowBytes;
+                jpeg_read_scanlines(&decompress, &row, 1);
+            }
+            jpeg_finish_decompress(&decompress);
+            jpeg_destroy_decompress(&decompress);
+
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || ms < bestMs)
+                bestMs = ms;
+        }
+        std::printf("  1/%u  %5ux%-5u %8.1f ms  %6.1f MB decoded\n",
+                    denominator, width, height, bestMs, decodedBytes / 1048576.0);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Times SubstringScanner over packed file names against what the file list
+// did before: QString::contains(..., Qt::CaseInsensitive) on each name, in
+// UTF-16. Also checks the scanner against std::string::find on random needles.
+//
+// usage: substringscanner_bench [name count]
+// Without a count it runs 1M and then 10M names; 10M needs about 1.5 GB.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include "substringscanner.h"
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+std::string lowered(std::string text)
+{
+    for (char &c : text)
+        c = char(std::tolower(static_cast<unsigned char>(c)));
+    return text;
+}
+
+bool run(int count)
+{
+    // Packed like WeldSearchEngine::foldedNames: "<part>-<serial>.JPG\n" one after another
+    std::mt19937 random(1);
+    std::string names;
+    std::vector<int> offsets;
+    offsets.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        char name[64];
+        std::snprintf(name, sizeof name, "%08d-%09d.JPG\n",
+                      21000000 + int(random() % 200000), int(random() % 1000000000));
+        offsets.push_back(int(names.size()));
+        names += name;
+    }
+
+    const std::string lowNames = lowered(names);
+    for (int trial = 0; trial < 200; ++trial) {
+        std::string needle;
+        for (int i = 1 + int(random() % 6); i > 0; --i)
+            needle += "0123456789-.jpJP"[random() % 16];
+        const int from = int(random() % 1000);
+        const size_t expected = lowNames.find(lowered(needle), size_t(from));
+        const int found = SubstringScanner(QByteArray(needle.c_str())).indexIn(names.data(), int(names.size()), from);
+        if ((expected == std::string::npos ? -1 : int(expected)) != found) {
+            std::printf("mismatch for '%s': %d, expected %d\n", needle.c_str(), found,
+                        expected == std::string::npos ? -1 : int(expected));
+            return false;
+        }
+    }
+
+    // The names as the list held them
+    QStringList nameList;
+    nameList.reserve(count);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        const int end = i + 1 < offsets.size() ? offsets[i + 1] : int(names.size());
+        nameList.append(QString::fromLatin1(names.data() + offsets[i], end - offsets[i] - 1));
+    }
+
+    std::printf("%s kernel, %d names\n", SubstringScanner::implementation(), count);
+    for (const char *query : {"1111", "9999999", "zz", "jpg"}) {
+        // One hit per name, as scanNames() skips to the next entry after a match
+        auto start = std::chrono::steady_clock::now();
+        const SubstringScanner scanner{QByteArray(query)};
+        long scannerHits = 0;
+        int from = 0;
+        for (;;) {
+            int hit = scanner.indexIn(names.data(), int(names.size()), from);
+            if (hit < 0)
+                break;
+            ++scannerHits;
+            auto next = std::upper_bound(offsets.begin(), offsets.end(), hit);
+            from = next == offsets.end() ? int(names.size()) : *next;
+        }
+        const double scannerMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        const QString needle = QString::fromLatin1(query);
+        long containsHits = 0;
+        for (const QString &name : nameList) {
+            if (name.contains(needle, Qt::CaseInsensitive))
+                ++containsHits;
+        }
+        const double containsMs = elapsedMs(start);
+
+        std::printf("  %-8s scanner %8.2f ms   QString::contains %8.2f ms   %ld/%ld hits\n",
+                    query, scannerMs, containsMs, scannerHits, containsHits);
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<int> counts{1000000, 10000000};
+    if (argc > 1)
+        counts = {std::atoi(argv[1])};
+    for (int count : counts) {
+        if (!run(count))
+            return 1;
+    }
+    return 0;
+}
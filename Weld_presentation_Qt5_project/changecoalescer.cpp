@@ -0,0 +1,40 @@
+#include "changecoalescer.h"
+
+#include "diagnostics.h"
+
+ChangeCoalescer::ChangeCoalescer(QObject *parent)
+    : QObject(parent)
+{
+    quietTimer.setSingleShot(true);
+    latencyTimer.setSingleShot(true);
+    quietTimer.setInterval(300);
+    latencyTimer.setInterval(2000);
+    connect(&quietTimer, &QTimer::timeout, this, &ChangeCoalescer::flush);
+    connect(&latencyTimer, &QTimer::timeout, this, &ChangeCoalescer::flush);
+}
+
+void ChangeCoalescer::notifyChange()
+{
+    ++received;
+    if (pending) {
+        ++merged;
+    } else {
+        pending = true;
+        latencyTimer.start();  // not restarted by later events of the same burst
+    }
+    quietTimer.start();
+}
+
+void ChangeCoalescer::flush()
+{
+    if (!pending)
+        return;
+    pending = false;
+    quietTimer.stop();
+    latencyTimer.stop();
+    ++rescans;
+
+    qCDebug(weldDiagnostics) << "Folder rescan" << rescans << "- events received:" << received
+             << "merged:" << merged;
+    emit rescanRequested();
+}
@@ -0,0 +1,42 @@
+#ifndef CHANGECOALESCER_H
+#define CHANGECOALESCER_H
+
+#include <QObject>
+#include <QTimer>
+
+// Turns a burst of change notifications into a single rescan.
+// The rescan runs once no event has arrived for the quiet window, or at the
+// latest after the max latency since the first event of the burst.
+class ChangeCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChangeCoalescer(QObject *parent = nullptr);
+
+    void setQuietWindow(int ms) { quietTimer.setInterval(ms); }
+    void setMaxLatency(int ms) { latencyTimer.setInterval(ms); }
+    int quietWindow() const { return quietTimer.interval(); }
+    int maxLatency() const { return latencyTimer.interval(); }
+
+    quint64 eventsReceived() const { return received; }
+    quint64 eventsMerged() const { return merged; }
+    quint64 rescansRun() const { return rescans; }
+
+public slots:
+    void notifyChange();
+    void flush();
+
+signals:
+    void rescanRequested();
+
+private:
+    QTimer quietTimer;
+    QTimer latencyTimer;
+    bool pending = false;
+    quint64 received = 0;
+    quint64 merged = 0;
+    quint64 rescans = 0;
+};
+
+#endif // CHANGECOALESCER_H
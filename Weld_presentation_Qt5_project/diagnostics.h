@@ -0,0 +1,10 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <QLoggingCategory>
+
+// Counters and timings for tuning a station. Off unless enabled, e.g. with
+// QT_LOGGING_RULES="weld.diagnostics.debug=true".
+Q_DECLARE_LOGGING_CATEGORY(weldDiagnostics)
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,91 @@
+#include "editdistance.h"
+
+#include <QVector>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+const int kWordBits = 64;
+
+inline quint8 foldAscii(char c)
+{
+    return quint8(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+}  // namespace
+
+EditDistanceMatcher::EditDistanceMatcher(const QByteArray &pattern)
+{
+    foldedPattern.resize(pattern.size());
+    for (int i = 0; i < pattern.size(); ++i)
+        foldedPattern[i] = char(foldAscii(pattern.at(i)));
+
+    std::fill(std::begin(matchMasks), std::end(matchMasks), 0);
+    for (int i = 0; i < qMin(int(foldedPattern.size()), kWordBits); ++i)
+        matchMasks[quint8(foldedPattern.at(i))] |= quint64(1) << i;
+}
+
+int EditDistanceMatcher::distance(const char *text, int length, int maxDistance) const
+{
+    const int m = foldedPattern.size();
+    if (std::abs(length - m) > maxDistance)
+        return maxDistance + 1;
+    if (m == 0)
+        return length;
+    if (m > kWordBits)
+        return dynamicDistance(text, length, maxDistance);
+
+    // Columns of the DP matrix as vertical +1/-1 deltas; score tracks its last row
+    quint64 plusVertical = m == kWordBits ? ~quint64(0) : (quint64(1) << m) - 1;
+    quint64 minusVertical = 0;
+    const quint64 lastRow = quint64(1) << (m - 1);
+    int score = m;
+
+    for (int j = 0; j < length; ++j) {
+        const quint64 eq = matchMasks[foldAscii(text[j])];
+        const quint64 xv = eq | minusVertical;
+        const quint64 xh = (((eq & plusVertical) + plusVertical) ^ plusVertical) | eq;
+        quint64 plusHorizontal = minusVertical | ~(xh | plusVertical);
+        quint64 minusHorizontal = plusVertical & xh;
+
+        if (plusHorizontal & lastRow)
+            ++score;
+        else if (minusHorizontal & lastRow)
+            --score;
+        // Each remaining text byte can lower the score by at most one
+        if (score - (length - j - 1) > maxDistance)
+            return maxDistance + 1;
+
+        // Whole-string distance: the top row of the matrix grows by one per text byte
+        plusHorizontal = (plusHorizontal << 1) | 1;
+        minusHorizontal <<= 1;
+        plusVertical = minusHorizontal | ~(xv | plusHorizontal);
+        minusVertical = plusHorizontal & xv;
+    }
+    return qMin(score, maxDistance + 1);
+}
+
+int EditDistanceMatcher::dynamicDistance(const char *text, int length, int maxDistance) const
+{
+    const int m = foldedPattern.size();
+    QVector<int> previous(length + 1);
+    QVector<int> current(length + 1);
+    for (int j = 0; j <= length; ++j)
+        previous[j] = j;
+
+    for (int i = 1; i <= m; ++i) {
+        current[0] = i;
+        int rowMinimum = i;
+        for (int j = 1; j <= length; ++j) {
+            int substitution = previous[j - 1] + (quint8(foldedPattern.at(i - 1)) != foldAscii(text[j - 1]));
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, substitution});
+            rowMinimum = qMin(rowMinimum, current[j]);
+        }
+        if (rowMinimum > maxDistance)
+            return maxDistance + 1;
+        std::swap(previous, current);
+    }
+    return qMin(previous[length], maxDistance + 1);
+}
@@ -0,0 +1,31 @@
+#ifndef EDITDISTANCE_H
+#define EDITDISTANCE_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// Levenshtein distance from one pattern to many short strings, such as a
+// typed serial against every serial in the table. Patterns of up to 64 bytes
+// use Myers' bit-parallel algorithm (one machine word per text byte, in
+// Hyyrö's formulation for whole-string distance); longer ones fall back to the
+// textbook dynamic programme. ASCII letters compare without case.
+class EditDistanceMatcher
+{
+public:
+    explicit EditDistanceMatcher(const QByteArray &pattern);
+
+    // Distance to text, or maxDistance + 1 as soon as it must exceed maxDistance
+    int distance(const char *text, int length, int maxDistance) const;
+    int distance(const QByteArray &text, int maxDistance) const
+    {
+        return distance(text.constData(), text.size(), maxDistance);
+    }
+
+private:
+    int dynamicDistance(const char *text, int length, int maxDistance) const;
+
+    QByteArray foldedPattern;
+    quint64 matchMasks[256];  // bit i set where the pattern has that byte at position i
+};
+
+#endif // EDITDISTANCE_H
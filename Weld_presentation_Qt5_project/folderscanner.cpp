@@ -0,0 +1,78 @@
+#include "folderscanner.h"
+
+#include <algorithm>
+
+#include "parallelwalker.h"
+
+namespace {
+const int kBatchSize = 512;
+}
+
+FolderScanner::FolderScanner(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<ScanRequest>("ScanRequest");
+    qRegisterMetaType<FolderSnapshot>("FolderSnapshot");
+    qRegisterMetaType<QVector<WeldRecord>>("QVector<WeldRecord>");
+}
+
+quint64 FolderScanner::requestScan(ScanRequest request)
+{
+    request.generation = ++latestGeneration;
+    QMetaObject::invokeMethod(this, [this, request]() { runScan(request); }, Qt::QueuedConnection);
+    return request.generation;
+}
+
+void FolderScanner::cancelAll()
+{
+    ++latestGeneration;
+}
+
+void FolderScanner::runScan(const ScanRequest &request)
+{
+    if (isStale(request.generation))
+        return;
+
+    //========== Enumerate ==========
+    // Sharded layouts (data/<part>/, data/YYYY/MM/DD/) are walked on all cores
+    const QHash<QString, WeldRecord> &known = request.known.records();
+    ParallelWalker walker(request.folderPath, request.nameFilters);
+    bool completed = walker.walk([&](WeldRecord &record, const QString &absolutePath) {
+        record.parseFileName();
+
+        // Only new or changed images, or ones whose sidecar arrived or changed, cost a read
+        auto found = known.constFind(record.fileName);
+        if (found != known.constEnd() && found->sameFileAs(record)) {
+            record.defectType = found->defectType;
+        } else {
+            record.defectType = readDefectType(sidecarPathFor(absolutePath));
+        }
+        return true;
+    }, [this, &request]() { return isStale(request.generation); });
+    if (!completed)
+        return;
+    QVector<WeldRecord> records = walker.records();
+
+    //========== Sort newest first ==========
+    std::sort(records.begin(), records.end(), [](const WeldRecord &a, const WeldRecord &b) {
+        return a.mtimeMs > b.mtimeMs;
+    });
+    if (isStale(request.generation))
+        return;
+
+    //========== Deliver ==========
+    if (request.streamBatches) {
+        for (int start = 0; start < records.size(); start += kBatchSize) {
+            if (isStale(request.generation))
+                return;
+            emit scanBatch(request, records.mid(start, kBatchSize));
+        }
+    }
+
+    FolderSnapshot snapshot;
+    snapshot.reserve(records.size());
+    snapshot.setDirectories(walker.directories());
+    for (const WeldRecord &record : records)
+        snapshot.insert(record);
+    emit scanFinished(request, snapshot);
+}
@@ -0,0 +1,50 @@
+#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+#include "foldersnapshot.h"
+#include "weldrecord.h"
+
+struct ScanRequest
+{
+    quint64 generation = 0;
+    QString folderPath;
+    QStringList nameFilters;
+    bool streamBatches = false;  // emit sorted batches as well as the final snapshot
+    FolderSnapshot known;        // catalog records whose sidecars need not be read again
+};
+
+// Enumerates and sorts the data folder on the thread it lives on.
+// Only the newest request runs to completion; older ones stop at the next check.
+class FolderScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FolderScanner(QObject *parent = nullptr);
+
+    // Thread safe. Returns the generation the results will carry.
+    quint64 requestScan(ScanRequest request);
+    void cancelAll();
+
+signals:
+    void scanBatch(const ScanRequest &request, const QVector<WeldRecord> &records);
+    void scanFinished(const ScanRequest &request, const FolderSnapshot &snapshot);
+
+private:
+    void runScan(const ScanRequest &request);
+    bool isStale(quint64 generation) const { return generation != latestGeneration.load(); }
+
+    std::atomic<quint64> latestGeneration{0};
+};
+
+Q_DECLARE_METATYPE(ScanRequest)
+Q_DECLARE_METATYPE(FolderSnapshot)
+
+#endif // FOLDERSCANNER_H
@@ -0,0 +1,41 @@
+#ifndef FOLDERSNAPSHOT_H
+#define FOLDERSNAPSHOT_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "weldrecord.h"
+
+// Changes between what is known and a fresh scan. A file whose size or mtime
+// changed shows up in both lists, so the caller can reposition it.
+struct FolderDiff
+{
+    QVector<WeldRecord> removed;   // as they were known before the scan
+    QVector<WeldRecord> inserted;
+
+    bool isEmpty() const { return removed.isEmpty() && inserted.isEmpty(); }
+};
+
+// The data folder keyed by path relative to the data root, with size and
+// mtime for each entry, plus every directory the scan went through.
+class FolderSnapshot
+{
+public:
+    void insert(const WeldRecord &record) { entries.insert(record.fileName, record); }
+    void remove(const QString &fileName) { entries.remove(fileName); }
+    void reserve(int count) { entries.reserve(count); }
+
+    const QHash<QString, WeldRecord> &records() const { return entries; }
+    int size() const { return entries.size(); }
+
+    void setDirectories(const QStringList &paths) { directoryPaths = paths; }
+    const QStringList &directories() const { return directoryPaths; }
+
+private:
+    QHash<QString, WeldRecord> entries;
+    QStringList directoryPaths;
+};
+
+#endif // FOLDERSNAPSHOT_H
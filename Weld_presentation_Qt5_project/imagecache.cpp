@@ -0,0 +1,79 @@
+#include "imagecache.h"
+
+#include <QMutexLocker>
+
+ImageCache::ImageCache(qint64 compressedBudgetBytes, qint64 decodedBudgetBytes)
+    : compressed(costOf(compressedBudgetBytes))
+    , decoded(costOf(decodedBudgetBytes))
+{
+}
+
+bool ImageCache::findCompressed(const QString &path, qint64 mtimeMs, QByteArray *bytes)
+{
+    QMutexLocker locker(&mutex);
+    if (QByteArray *cached = compressed.object(keyOf(path, mtimeMs))) {
+        *bytes = *cached;
+        ++compressedCounts.hits;
+        return true;
+    }
+    ++compressedCounts.misses;
+    return false;
+}
+
+void ImageCache::insertCompressed(const QString &path, qint64 mtimeMs, const QByteArray &bytes)
+{
+    QMutexLocker locker(&mutex);
+    insertInto(compressed, compressedCounts, keyOf(path, mtimeMs), new QByteArray(bytes), costOf(bytes.size()));
+}
+
+bool ImageCache::findDecoded(const QString &path, qint64 mtimeMs, const QSize &targetSize, QImage *image)
+{
+    QMutexLocker locker(&mutex);
+    if (QImage *cached = decoded.object(keyOf(path, mtimeMs, targetSize))) {
+        *image = *cached;
+        ++decodedCounts.hits;
+        return true;
+    }
+    ++decodedCounts.misses;
+    return false;
+}
+
+bool ImageCache::containsDecoded(const QString &path, qint64 mtimeMs, const QSize &targetSize) const
+{
+    QMutexLocker locker(&mutex);
+    return decoded.contains(keyOf(path, mtimeMs, targetSize));
+}
+
+void ImageCache::insertDecoded(const QString &path, qint64 mtimeMs, const QSize &targetSize, const QImage &image)
+{
+    QMutexLocker locker(&mutex);
+    insertInto(decoded, decodedCounts, keyOf(path, mtimeMs, targetSize), new QImage(image),
+               costOf(qint64(image.bytesPerLine()) * image.height()));
+}
+
+ImageCache::TierStats ImageCache::compressedStats() const
+{
+    QMutexLocker locker(&mutex);
+    TierStats stats = compressedCounts;
+    stats.entries = compressed.count();
+    stats.bytes = qint64(compressed.totalCost()) * 1024;
+    return stats;
+}
+
+ImageCache::TierStats ImageCache::decodedStats() const
+{
+    QMutexLocker locker(&mutex);
+    TierStats stats = decodedCounts;
+    stats.entries = decoded.count();
+    stats.bytes = qint64(decoded.totalCost()) * 1024;
+    return stats;
+}
+
+// QCache evicts silently; what it dropped shows in its entry count
+template <typename T>
+void ImageCache::insertInto(QCache<QString, T> &tier, TierStats &stats, const QString &key, T *object, int cost)
+{
+    int before = tier.count() - (tier.contains(key) ? 1 : 0);
+    if (tier.insert(key, object, cost))
+        stats.evictions += quint64(qMax(0, before + 1 - tier.count()));
+}
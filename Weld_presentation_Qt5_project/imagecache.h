@@ -0,0 +1,60 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+// Weld images the operator has already looked at, in two tiers: the file
+// bytes as read from disk (large budget, cheap to hold, still need a
+// decode) and decoded images scaled for display (smaller budget, shown as
+// they are). Entries are keyed by path and mtime, decoded ones also by the
+// size they were scaled for, so a rewritten file or a resized label never
+// gets a stale picture. Each tier drops its least recently used entries
+// once over its byte budget. Thread safe.
+class ImageCache
+{
+public:
+    struct TierStats
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        int entries = 0;
+        qint64 bytes = 0;
+    };
+
+    ImageCache(qint64 compressedBudgetBytes, qint64 decodedBudgetBytes);
+
+    bool findCompressed(const QString &path, qint64 mtimeMs, QByteArray *bytes);
+    void insertCompressed(const QString &path, qint64 mtimeMs, const QByteArray &bytes);
+    bool findDecoded(const QString &path, qint64 mtimeMs, const QSize &targetSize, QImage *image);
+    // Unlike findDecoded(), neither counted nor made more recent
+    bool containsDecoded(const QString &path, qint64 mtimeMs, const QSize &targetSize) const;
+    void insertDecoded(const QString &path, qint64 mtimeMs, const QSize &targetSize, const QImage &image);
+
+    TierStats compressedStats() const;
+    TierStats decodedStats() const;
+
+private:
+    // QCache counts cost in int; kilobytes keep budgets of gigabytes in range
+    static int costOf(qint64 bytes) { return int(bytes / 1024) + 1; }
+    static QString keyOf(const QString &path, qint64 mtimeMs) { return path + '|' + QString::number(mtimeMs); }
+    static QString keyOf(const QString &path, qint64 mtimeMs, const QSize &size)
+    {
+        return keyOf(path, mtimeMs) + QString("|%1x%2").arg(size.width()).arg(size.height());
+    }
+    template <typename T>
+    static void insertInto(QCache<QString, T> &tier, TierStats &stats, const QString &key, T *object, int cost);
+
+    mutable QMutex mutex;
+    QCache<QString, QByteArray> compressed;
+    QCache<QString, QImage> decoded;
+    TierStats compressedCounts;
+    TierStats decodedCounts;
+};
+
+#endif // IMAGECACHE_H
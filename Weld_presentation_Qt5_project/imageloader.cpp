@@ -0,0 +1,166 @@
+#include "imageloader.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QThread>
+
+#include "diagnostics.h"
+#include "pooltask.h"
+
+namespace {
+
+// The smallest size a JPEG decoder reaches by DCT scaling alone (1/8, 1/4,
+// 1/2 of the full size) that still covers target, so the final resample
+// only ever shrinks. Asking for it makes the decoder skip the rest of the
+// work and never hold the full-resolution pixels.
+QSize reducedDecodeSize(const QSize &fullSize, const QSize &target)
+{
+    for (int denominator = 8; denominator > 1; denominator /= 2) {
+        QSize reduced(fullSize.width() / denominator, fullSize.height() / denominator);
+        if (reduced.width() >= target.width() && reduced.height() >= target.height())
+            return reduced;
+    }
+    return fullSize;
+}
+
+}  // namespace
+
+ImageLoader::ImageLoader(qint64 compressedCacheBytes, qint64 decodedCacheBytes, QObject *parent)
+    : QObject(parent)
+    , imageCache(compressedCacheBytes, decodedCacheBytes)
+{
+    qRegisterMetaType<ImageRequest>("ImageRequest");
+    // One decode for the current click, one for a stale click winding down
+    decodePool.setMaxThreadCount(2);
+    // Prefetching must leave the cores to the click the operator waits for
+    prefetchPool.setMaxThreadCount(1);
+}
+
+ImageLoader::~ImageLoader()
+{
+    cancelAll();
+    cancelPrefetch();
+    decodePool.waitForDone();
+    prefetchPool.waitForDone();
+}
+
+bool ImageLoader::cachedImage(const QString &path, qint64 mtimeMs, const QSize &labelSize, QImage *image)
+{
+    return imageCache.findDecoded(path, mtimeMs, labelSize, image);
+}
+
+quint64 ImageLoader::load(const QString &path, qint64 mtimeMs, const QSize &labelSize)
+{
+    ImageRequest request;
+    request.generation = ++latestGeneration;
+    request.path = path;
+    request.mtimeMs = mtimeMs;
+    request.labelSize = labelSize;
+
+    startInPool(decodePool, [this, request]() { decode(request); });
+    return request.generation;
+}
+
+void ImageLoader::cancelAll()
+{
+    ++latestGeneration;
+}
+
+void ImageLoader::prefetch(const QVector<ImageRequest> &requests)
+{
+    const quint64 generation = ++prefetchGeneration;
+    for (ImageRequest request : requests) {
+        request.generation = generation;
+        startInPool(prefetchPool, [this, request]() {
+            if (isPrefetchStale(request.generation)
+                || imageCache.containsDecoded(request.path, request.mtimeMs, request.labelSize))
+                return;
+            QThread::currentThread()->setPriority(QThread::LowPriority);
+            QString error;
+            readScaled(request, [this, request]() { return isPrefetchStale(request.generation); }, &error);
+        });
+    }
+}
+
+void ImageLoader::cancelPrefetch()
+{
+    ++prefetchGeneration;
+}
+
+QSize ImageLoader::displaySize(const QSize &imageSize, const QSize &labelSize)
+{
+    QSize doubleSize = imageSize * 2;
+    if (doubleSize.width() <= labelSize.width() && doubleSize.height() <= labelSize.height())
+        return doubleSize;
+    return labelSize;
+}
+
+// Runs on a decode thread
+void ImageLoader::decode(const ImageRequest &request)
+{
+    if (isStale(request.generation))
+        return;
+
+    QString error;
+    QImage image = readScaled(request, [this, request]() { return isStale(request.generation); }, &error);
+    if (isStale(request.generation))
+        return;
+    if (image.isNull())
+        emit imageFailed(request, error);
+    else
+        emit imageLoaded(request, image);
+}
+
+// The display image, read through both cache tiers and added to them.
+// A null image if decoding failed (with error set) or stale() turned true.
+QImage ImageLoader::readScaled(const ImageRequest &request, const std::function<bool()> &stale, QString *error)
+{
+    QByteArray bytes;
+    if (!imageCache.findCompressed(request.path, request.mtimeMs, &bytes)) {
+        QFile file(request.path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *error = file.errorString();
+            return QImage();
+        }
+        bytes = file.readAll();
+        imageCache.insertCompressed(request.path, request.mtimeMs, bytes);
+    }
+    if (stale())
+        return QImage();
+
+    QElapsedTimer timer;
+    timer.start();
+    QBuffer buffer(&bytes);
+    QImageReader reader(&buffer);
+    const QSize fullSize = reader.size();
+    QSize targetSize;
+    if (fullSize.isValid()) {
+        targetSize = fullSize.scaled(displaySize(fullSize, request.labelSize), Qt::KeepAspectRatio);
+        if (reader.supportsOption(QImageIOHandler::ScaledSize)) {
+            QSize reduced = reducedDecodeSize(fullSize, targetSize);
+            if (reduced != fullSize)
+                reader.setScaledSize(reduced);
+        }
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        *error = reader.errorString();
+        return QImage();
+    }
+    const qint64 decodeMs = timer.elapsed();
+    if (stale())
+        return QImage();
+
+    if (!targetSize.isValid())
+        targetSize = image.size().scaled(displaySize(image.size(), request.labelSize), Qt::KeepAspectRatio);
+    QImage scaled = image.scaled(targetSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    imageCache.insertDecoded(request.path, request.mtimeMs, request.labelSize, scaled);
+
+    if (timer.elapsed() > 50)
+        qCDebug(weldDiagnostics) << "Decoded" << request.path << fullSize << "as" << image.size() << "in" << decodeMs
+                 << "ms, scaled to" << scaled.size() << "in" << timer.elapsed() - decodeMs << "ms";
+    return scaled;
+}
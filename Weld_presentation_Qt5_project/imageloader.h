@@ -0,0 +1,74 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+
+#include "imagecache.h"
+
+struct ImageRequest
+{
+    quint64 generation = 0;
+    QString path;
+    qint64 mtimeMs = 0;  // part of the cache key
+    QSize labelSize;  // the image is scaled to fit, at most twice its own size
+};
+
+// Decodes and scales weld images on worker threads, so a click on a 20 MP
+// capture no longer freezes the GUI thread; the result is a QImage ready to
+// become weldImageLabel's pixmap. Only the newest request matters: an older
+// one still being decoded is dropped rather than reported. Files read and
+// images scaled go into an ImageCache, so flipping between welds skips the
+// disk and usually the decode too. prefetch() fills the cache with the
+// welds the operator is likely to look at next, one at a time at low thread
+// priority, and gives way as soon as the selection moves on.
+class ImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    ImageLoader(qint64 compressedCacheBytes, qint64 decodedCacheBytes, QObject *parent = nullptr);
+    ~ImageLoader();
+
+    // The display image if it is cached already; no need to load() it then
+    bool cachedImage(const QString &path, qint64 mtimeMs, const QSize &labelSize, QImage *image);
+    // Returns the generation the result will carry
+    quint64 load(const QString &path, qint64 mtimeMs, const QSize &labelSize);
+    void cancelAll();
+
+    // Decodes into the cache, in the order given; replaces any earlier prefetch
+    void prefetch(const QVector<ImageRequest> &requests);
+    void cancelPrefetch();
+
+    const ImageCache &cache() const { return imageCache; }
+
+    // Twice the image size if that fits the label, else the label size
+    static QSize displaySize(const QSize &imageSize, const QSize &labelSize);
+
+signals:
+    void imageLoaded(const ImageRequest &request, const QImage &image);
+    void imageFailed(const ImageRequest &request, const QString &error);
+
+private:
+    void decode(const ImageRequest &request);
+    QImage readScaled(const ImageRequest &request, const std::function<bool()> &stale, QString *error);
+    bool isStale(quint64 generation) const { return generation != latestGeneration.load(); }
+    bool isPrefetchStale(quint64 generation) const { return generation != prefetchGeneration.load(); }
+
+    std::atomic<quint64> latestGeneration{0};
+    std::atomic<quint64> prefetchGeneration{0};
+    ImageCache imageCache;
+    QThreadPool decodePool;
+    QThreadPool prefetchPool;
+};
+
+Q_DECLARE_METATYPE(ImageRequest)
+
+#endif // IMAGELOADER_H
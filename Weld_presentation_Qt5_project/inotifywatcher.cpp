@@ -0,0 +1,148 @@
+#include "inotifywatcher.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+InotifyWatcher::InotifyWatcher(QObject *parent)
+    : QObject(parent)
+{
+#ifdef Q_OS_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        qDebug() << "inotify is not available, falling back to QFileSystemWatcher";
+        return;
+    }
+    notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(notifier, QOverload<QSocketDescriptor, QSocketNotifier::Type>::of(&QSocketNotifier::activated),
+            this, &InotifyWatcher::readEvents);
+#else
+    connect(notifier, QOverload<int>::of(&QSocketNotifier::activated), this, &InotifyWatcher::readEvents);
+#endif
+#endif
+}
+
+InotifyWatcher::~InotifyWatcher()
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+#endif
+}
+
+bool InotifyWatcher::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool InotifyWatcher::addDirectory(const QString &path)
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd < 0)
+        return false;
+
+    const uint32_t mask = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO
+                          | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+    int watch = inotify_add_watch(inotifyFd, QFile::encodeName(path).constData(), mask);
+    if (watch < 0) {
+        qDebug() << "inotify_add_watch failed for" << path << "errno" << errno;
+        return false;
+    }
+    directoriesByWatch.insert(watch, path);
+    return true;
+#else
+    Q_UNUSED(path);
+    return false;
+#endif
+}
+
+bool InotifyWatcher::addDirectoryTree(const QString &root)
+{
+    if (!addDirectory(root))
+        return false;
+
+    QDirIterator it(root, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        addDirectory(it.next());
+    return true;
+}
+
+void InotifyWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[64 * 1024];
+
+    for (;;) {
+        ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            return;  // EAGAIN: drained
+
+        for (char *pos = buffer; pos < buffer + length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(pos);
+            pos += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                qDebug() << "inotify queue overflowed, requesting a full rescan";
+                emit overflowed();
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                directoriesByWatch.remove(event->wd);  // the directory itself went away
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+
+            const QString path = directoriesByWatch.value(event->wd) + "/" + QFile::decodeName(event->name);
+            if (event->mask & IN_ISDIR) {
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && addDirectoryTree(path)) {
+                    emit directoryAdded(path);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    // No event comes for the files that went with it
+                    removeDirectoryTree(path);
+                    emit directoryRemoved(path);
+                }
+                continue;
+            }
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                emit fileWritten(path);
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                emit fileRemoved(path);
+            else if (event->mask & (IN_CREATE | IN_MODIFY))
+                emit fileStarted(path);
+        }
+    }
+#endif
+}
+
+// A directory renamed away keeps its watches, and they would report under
+// the old path; a deleted one has them dropped by the kernel anyway
+void InotifyWatcher::removeDirectoryTree(const QString &root)
+{
+#ifdef Q_OS_LINUX
+    const QString prefix = root + "/";
+    for (auto it = directoriesByWatch.begin(); it != directoriesByWatch.end();) {
+        if (it.value() == root || it.value().startsWith(prefix)) {
+            inotify_rm_watch(inotifyFd, it.key());
+            it = directoriesByWatch.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#else
+    Q_UNUSED(root);
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef INOTIFYWATCHER_H
+#define INOTIFYWATCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+// Per-file change notifications for a directory, using inotify on Linux.
+// Unlike QFileSystemWatcher it says which file changed and how.
+// On other platforms addDirectory() fails and callers fall back to rescans.
+class InotifyWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InotifyWatcher(QObject *parent = nullptr);
+    ~InotifyWatcher();
+
+    static bool isSupported();
+    bool addDirectory(const QString &path);
+    // Watches a directory and everything below it; new subdirectories are picked up as they appear
+    bool addDirectoryTree(const QString &root);
+
+signals:
+    void fileStarted(const QString &path);   // created or being modified
+    void fileWritten(const QString &path);   // closed after writing, or renamed into place
+    void fileRemoved(const QString &path);   // deleted or renamed away
+    void directoryAdded(const QString &path); // now watched; files may have landed before that
+    void directoryRemoved(const QString &path); // deleted or renamed away, with everything below it
+    void overflowed();                       // events were lost; a full rescan is needed
+
+private:
+    void readEvents();
+    void removeDirectoryTree(const QString &root);
+
+    int inotifyFd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QHash<int, QString> directoriesByWatch;
+};
+
+#endif // INOTIFYWATCHER_H
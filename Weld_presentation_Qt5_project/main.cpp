@@ -1,10 +1,15 @@
 #include "mainwindow.h"
+#include "startupprofiler.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler::begin(StartupProfiler::FirstPaintPhase);
+    StartupProfiler::begin(StartupProfiler::QApplicationPhase);
     QApplication a(argc, argv);
+    StartupProfiler::end(StartupProfiler::QApplicationPhase);
+
     MainWindow w;
     w.show();
     return a.exec();
@@ -1,15 +1,29 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 
+#include <QDirIterator>
+#include <QItemSelectionModel>
+#include <QScrollBar>
+
+#include "appsettings.h"
+#include "diagnostics.h"
+#include "startupprofiler.h"
+
 QString getDataFolderPath() {
     return QCoreApplication::applicationDirPath() + "/data";
 }
 
+QStringList getImageNameFilters() {
+    return {"*.jpg", "*.JPG", "*.jpeg", "*.JPEG"};
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
+    StartupProfiler::begin(StartupProfiler::SetupUiPhase);
     ui->setupUi(this);
+    StartupProfiler::end(StartupProfiler::SetupUiPhase);
     // Change background
     QString sourcePath = QString(__FILE__); // full path to mainwindow.cpp
     QFileInfo fileInfo(sourcePath);
@@ -21,50 +35,80 @@ MainWindow::MainWindow(QWidget *parent)
                                 "background-repeat: no-repeat;"
                                 "background-position: center;"
                                 "}").arg(backgroundPath));
-    //========== Folder ================================
-    //Get the "data" folder
-    QString dataContainingFolder = getDataFolderPath();
-    qDebug()  << dataContainingFolder;
-    QDir dir(dataContainingFolder);
+    //========== Background folder scanner ================================
+    folderScanner = new FolderScanner;
+    folderScanner->moveToThread(&scannerThread);
+    connect(&scannerThread, &QThread::finished, folderScanner, &QObject::deleteLater);
+    connect(folderScanner, &FolderScanner::scanBatch, this, &MainWindow::show_scan_batch);
+    connect(folderScanner, &FolderScanner::scanFinished, this, &MainWindow::finish_scan);
+    scannerThread.start();
+    //========================================================================
 
-    //Check if the folder exist
-    if(!dir.exists())
-    {
-        qDebug() << "Data folder not exist!!!. Please create a folder name 'data'";
-        return;
-    }
-    //==========Get all the files==============
-    //Filter only the .jpg files
-    QStringList imageFormatFilters;
-    imageFormatFilters << "*.jpg" << "*.JPG";  // include both lowercase and uppercase
-    QFileInfoList fileList = dir.entryInfoList(imageFormatFilters, QDir::Files | QDir::NoDotAndDotDot);
+    //========== Background sidecar indexer ================================
+    sidecarIndexer = new SidecarIndexer;
+    sidecarIndexer->moveToThread(&indexerThread);
+    connect(&indexerThread, &QThread::finished, sidecarIndexer, &QObject::deleteLater);
+    connect(sidecarIndexer, &SidecarIndexer::sidecarsRead, this, &MainWindow::index_sidecars);
+    indexerThread.start();
+    //========================================================================
 
-    //Display onto the list widget
-    for (const QFileInfo &file : fileList) {
-        ui->weldImageList->addItem(file.fileName());
-    }
+    //========== Search on the thread pool ================================
+    searchRunner = new SearchRunner(this);
+    connect(searchRunner, &SearchRunner::firstResultsFound, this, &MainWindow::show_first_results);
+    connect(searchRunner, &SearchRunner::searchFinished, this, &MainWindow::finish_search);
     //========================================================================
 
-    //======== Folder refresh timer ===================
-    folderWatcher = new QFileSystemWatcher(this);
-    QString dataPath = getDataFolderPath();
-    folderWatcher->addPath(dataPath);
+    //========== Image decoding off the GUI thread ================================
+    imageLoader = new ImageLoader(appSettings().value("imageCache/compressedMB", 256).toLongLong() * 1024 * 1024,
+                                  appSettings().value("imageCache/decodedMB", 64).toLongLong() * 1024 * 1024, this);
+    connect(imageLoader, &ImageLoader::imageLoaded, this, &MainWindow::show_image);
+    connect(imageLoader, &ImageLoader::imageFailed, this, &MainWindow::show_image_error);
     //========================================================================
 
+    //========== Tiled view of very large images ================================
+    pyramidBuilder = new PyramidBuilder(appSettings().value("pyramids/path",
+                                        QCoreApplication::applicationDirPath() + "/pyramids").toString(), this);
+    connect(pyramidBuilder, &PyramidBuilder::pyramidBuilt, this, &MainWindow::show_built_pyramid);
+    pyramidView = new PyramidView(ui->weldImageLabel->parentWidget());
+    pyramidView->setGeometry(ui->weldImageLabel->geometry().adjusted(5, 5, -5, -5));  // inside the label's border
+    pyramidView->hide();
+    //========================================================================
+
+    //========== Weld list model ================================
+    weldListModel = new WeldListModel(&recordTable, this);
+    thumbnailLoader = new ThumbnailLoader(getDataFolderPath(),
+                                          appSettings().value("thumbnails/path",
+                                          QCoreApplication::applicationDirPath() + "/thumbnails").toString(), this);
+    thumbnailLoader->trimDiskCache(appSettings().value("thumbnails/diskCacheMB", 256).toLongLong() * 1024 * 1024);
+    weldListModel->setThumbnailLoader(thumbnailLoader);
+    ui->weldImageList->setIconSize(QSize(ThumbnailLoader::kWidth, ThumbnailLoader::kHeight));
+    ui->weldImageList->setModel(weldListModel);
+    //========================================================================
+
+    // Bursts of directory changes (e.g. during an S3 sync) are merged into one rescan
+    changeCoalescer = new ChangeCoalescer(this);
+    changeCoalescer->setQuietWindow(appSettings().value("watcher/quietWindowMs", 300).toInt());
+    changeCoalescer->setMaxLatency(appSettings().value("watcher/maxLatencyMs", 2000).toInt());
+
     //================== S3 sync timer ============================
-    QTimer *syncTimer = new QTimer(this);
+    // Started once the first scan is done, so it does not compete with startup
+    syncTimer = new QTimer(this);
     connect(syncTimer, &QTimer::timeout, this, &MainWindow::sync_data_S3_to_local);
-    syncTimer->start(1000);  // Every 1 second
     //================== S3 sync timer ============================
 
     //Connections
-    connect(ui->weldImageList, &QListWidget::itemClicked,
-            this, &MainWindow::on_fileItem_clicked);
+    // Follows the arrow keys and Page Up/Down as well as clicks
+    connect(ui->weldImageList->selectionModel(), &QItemSelectionModel::currentChanged,
+            this, &MainWindow::show_current_file);
 
     connect(ui->searchButton, &QPushButton::clicked,
             this, &MainWindow::on_searchButton_clicked);
 
-    connect(folderWatcher, &QFileSystemWatcher::directoryChanged,
+    // Searching is done in memory, so the list can follow every keystroke
+    connect(ui->weldSearchTypeBox, &QLineEdit::textChanged,
+            this, &MainWindow::show_search_results);
+
+    connect(changeCoalescer, &ChangeCoalescer::rescanRequested,
             this, &MainWindow::update_file_list);
 
     connect(ui->clearDataButton, &QPushButton::clicked,
@@ -76,86 +120,329 @@ MainWindow::MainWindow(QWidget *parent)
     QRect availableGeometry = screen->availableGeometry();
     move(availableGeometry.center() - this->rect().center());
 
-    //=== Start timer =====
+    // The catalog, the watcher and the scan start after the first paint (see paintEvent)
+}
+
+void MainWindow::paintEvent(QPaintEvent *event) {
+    QMainWindow::paintEvent(event);
+    if (startupStarted)
+        return;
+
+    startupStarted = true;
+    StartupProfiler::end(StartupProfiler::FirstPaintPhase);
+    QTimer::singleShot(0, this, &MainWindow::start_deferred_startup);
+}
+
+void MainWindow::start_deferred_startup() {
+    //========== Folder ================================
+    //Get the "data" folder
+    QString dataContainingFolder = getDataFolderPath();
+    qDebug()  << dataContainingFolder;
+    QDir dir(dataContainingFolder);
+
+    //Check if the folder exist
+    if(!dir.exists())
+    {
+        qDebug() << "Data folder not exist!!!. Please create a folder name 'data'";
+        return;
+    }
+    //==========Get all the files==============
+    // Show the catalog from the last run right away; the scan below reconciles
+    // it against the folder in the background
+    StartupProfiler::begin(StartupProfiler::CatalogPhase);
+    weldCatalog = new WeldCatalog(appSettings().value("catalog/path",
+                                  QCoreApplication::applicationDirPath() + "/catalog").toString());
+    weldCatalog->load();
+    show_catalog_records();
+    StartupProfiler::end(StartupProfiler::CatalogPhase);
+    //========================================================================
+
+    //======== Folder refresh timer ===================
+    QString dataPath = getDataFolderPath();
+
+    // On Linux, inotify reports each finished file so records are added without a rescan.
+    // Elsewhere, or if inotify cannot be used, every change triggers a coalesced rescan.
+    inotifyWatcher = new InotifyWatcher(this);
+    if (appSettings().value("watcher/useInotify", true).toBool() && inotifyWatcher->addDirectoryTree(dataPath)) {
+        ingestTracker = new WeldIngestTracker(this);
+        connect(inotifyWatcher, &InotifyWatcher::fileStarted, ingestTracker, &WeldIngestTracker::fileStarted);
+        connect(inotifyWatcher, &InotifyWatcher::fileWritten, ingestTracker, &WeldIngestTracker::fileWritten);
+        connect(inotifyWatcher, &InotifyWatcher::fileRemoved, ingestTracker, &WeldIngestTracker::fileRemoved);
+        connect(inotifyWatcher, &InotifyWatcher::overflowed, changeCoalescer, &ChangeCoalescer::notifyChange);
+        connect(inotifyWatcher, &InotifyWatcher::directoryAdded, changeCoalescer, &ChangeCoalescer::notifyChange);
+        connect(inotifyWatcher, &InotifyWatcher::directoryRemoved, changeCoalescer, &ChangeCoalescer::notifyChange);
+        connect(ingestTracker, &WeldIngestTracker::recordReady, this, &MainWindow::ingest_record);
+        connect(ingestTracker, &WeldIngestTracker::recordRemoved, this, &MainWindow::drop_record);
+    } else {
+        // Subdirectories are added as scans find them
+        folderWatcher = new QFileSystemWatcher(this);
+        folderWatcher->addPath(dataPath);
+        connect(folderWatcher, &QFileSystemWatcher::directoryChanged,
+                changeCoalescer, &ChangeCoalescer::notifyChange);
+    }
+    //========================================================================
+
+    //=== The one startup scan =====
+    StartupProfiler::begin(StartupProfiler::ScanPhase);
     update_file_list();
 }
 
 MainWindow::~MainWindow()
 {
+    searchRunner->cancelAll();
+    imageLoader->cancelAll();
+    imageLoader->cancelPrefetch();
+    SearchResultCache::Stats stats = searchCache.stats();
+    qCDebug(weldDiagnostics) << "Search result cache:" << stats.hits << "hits," << stats.refinements << "refined," << stats.misses << "misses";
+    ImageCache::TierStats fileStats = imageLoader->cache().compressedStats();
+    ImageCache::TierStats imageStats = imageLoader->cache().decodedStats();
+    qCDebug(weldDiagnostics) << "Image cache, files:" << fileStats.hits << "hits," << fileStats.misses << "misses,"
+             << fileStats.evictions << "evicted," << fileStats.entries << "held in" << fileStats.bytes << "bytes";
+    qCDebug(weldDiagnostics) << "Image cache, decoded:" << imageStats.hits << "hits," << imageStats.misses << "misses,"
+             << imageStats.evictions << "evicted," << imageStats.entries << "held in" << imageStats.bytes << "bytes";
+    folderScanner->cancelAll();
+    scannerThread.quit();
+    scannerThread.wait();
+    sidecarIndexer->stop();
+    indexerThread.quit();
+    indexerThread.wait();
+    if (weldCatalog) {
+        weldCatalog->compact();
+        delete weldCatalog;
+    }
     delete ui;
 }
 
 void MainWindow::on_searchButton_clicked()
+{
+    // The list already follows the search box; this only forces it to run again
+    apply_search(ui->weldSearchTypeBox->text().trimmed());
+}
+
+void MainWindow::show_search_results()
 {
     QString searchText = ui->weldSearchTypeBox->text().trimmed();
-    QString dataPath = getDataFolderPath();
+    if (searchText != activeSearchText)
+        apply_search(searchText);
+}
 
-    QDir dir(dataPath);
-    QStringList nameFilters;
-    nameFilters << "*.jpg" << "*.JPG" << "*.jpeg" << "*.JPEG";
+void MainWindow::apply_search(const QString &searchText)
+{
+    activeSearchText = searchText;
+    activeQuery = WeldQuery::parse(searchText);
+
+    // An empty search matches every file, which is the same as the folder view
+    if (!activeQuery.error.isEmpty() || searchText.isEmpty()) {
+        searchRunner->cancelAll();
+        activeSearchGeneration = 0;
+        QString selectedName = current_file_name();
+        if (selectedName.isEmpty())
+            selectedName = searchSelection;
+        searchSelection.clear();
+        if (!activeQuery.error.isEmpty()) {
+            weldListModel->setEmptyText("(" + activeQuery.error + ")");
+            weldListModel->showRecords(QVector<quint32>());
+        } else {
+            weldListModel->setEmptyText(QString());
+            weldListModel->showAllRecords();
+        }
+        select_file(selectedName);
+        apply_deferred_changes();
+        return;
+    }
 
-    QFileInfoList allFiles = dir.entryInfoList(nameFilters, QDir::Files | QDir::NoDotAndDotDot);
+    // The search runs on the thread pool; the list keeps its rows until it is done
+    searchTimer.start();
+    start_search();
+}
 
-    // Filter matching files
-    QFileInfoList matchedFiles;
-    for (const QFileInfo &file : allFiles) {
-        if (file.fileName().contains(searchText, Qt::CaseInsensitive)) {
-            matchedFiles.append(file);
-        }
+void MainWindow::start_search()
+{
+    searchCacheVersion = searchCache.version();
+
+    QVector<quint32> cached;
+    switch (searchCache.lookup(activeQuery, cached)) {
+    case SearchResultCache::Exact:
+        searchRunner->cancelAll();
+        activeSearchGeneration = 0;
+        show_found_records(cached);
+        apply_deferred_changes();
+        break;
+    case SearchResultCache::Broader:
+        activeSearchGeneration = searchRunner->startWithin(recordTable, searchEngine, activeQuery, cached);
+        break;
+    case SearchResultCache::Miss:
+        activeSearchGeneration = searchRunner->start(recordTable, searchEngine, activeQuery);
+        break;
     }
+}
 
-    // Sort newest first
-    std::sort(matchedFiles.begin(), matchedFiles.end(), [](const QFileInfo &a, const QFileInfo &b) {
-        return a.lastModified() > b.lastModified();
-    });
+// The full results follow and keep these rows where they are
+void MainWindow::show_first_results(quint64 generation, const QVector<quint32> &ids)
+{
+    if (generation != activeSearchGeneration)
+        return;
 
-    ui->weldImageList->clear();
+    QString selectedName = current_file_name();
+    weldListModel->showRecords(ids, activeQuery.sortKey(), activeQuery.reversed());
+    select_file(selectedName);
+    if (!selectedName.isEmpty() && current_file_name().isEmpty())
+        searchSelection = selectedName;
+}
 
-    for (const QFileInfo &file : matchedFiles) {
-        ui->weldImageList->addItem(file.fileName());
+void MainWindow::finish_search(quint64 generation, const QVector<quint32> &ids)
+{
+    if (generation != activeSearchGeneration)
+        return;  // superseded by a newer keystroke
+
+    activeSearchGeneration = 0;
+    searchCache.insert(activeQuery, ids, searchCacheVersion);
+    show_found_records(ids);
+    // Changes held back while it ran now reach the table, and the list through the active query
+    apply_deferred_changes();
+}
+
+void MainWindow::show_found_records(const QVector<quint32> &ids)
+{
+    // A long number that matches nothing is most likely a mistyped serial
+    if (ids.isEmpty() && !activeQuery.isRanked()) {
+        WeldQuery fuzzy = activeQuery.asFuzzySerial();
+        if (fuzzy.isRanked()) {
+            activeQuery = fuzzy;
+            start_search();
+            return;
+        }
     }
 
-    if (matchedFiles.isEmpty()) {
-        ui->weldImageList->addItem("(No matches found)");
+    QString selectedName = current_file_name();
+    if (selectedName.isEmpty())
+        selectedName = searchSelection;
+    searchSelection.clear();
+    weldListModel->setEmptyText("(No matches found)");
+    if (activeQuery.isRanked())
+        weldListModel->showRankedRecords(ids);
+    else
+        weldListModel->showRecords(ids, activeQuery.sortKey(), activeQuery.reversed());
+    select_file(selectedName);
+
+    if (searchTimer.elapsed() > 10) {
+        SearchResultCache::Stats stats = searchCache.stats();
+        qDebug() << "Search for" << activeSearchText << "took" << searchTimer.elapsed() << "ms over" << recordTable.count() << "records;"
+                 << "result cache:" << stats.hits << "hits," << stats.refinements << "refined," << stats.misses << "misses,"
+                 << searchCache.memoryBytes() << "bytes";
     }
 }
 
-void MainWindow::on_fileItem_clicked(QListWidgetItem *item) {
-    if (!item) return;
+// A refresh or search that keeps the same weld current leaves its image alone
+void MainWindow::show_current_file(const QModelIndex &current) {
+    if (!current.isValid())
+        return;
+    QString fileName = current.data(WeldListModel::RelativePathRole).toString();
+    quint32 id = recordTable.idOf(fileName);
+    qint64 mtimeMs = id != WeldRecordTable::kInvalidId ? recordTable.mtimeMs(id) : 0;
+    if (getDataFolderPath() + "/" + fileName == shownImagePath && mtimeMs == shownImageMtimeMs)
+        return;
+    on_fileItem_clicked(current);
+}
+
+void MainWindow::on_fileItem_clicked(const QModelIndex &index) {
+    if (!index.isValid() || !(index.flags() & Qt::ItemIsSelectable)) return;
 
-    QString fileName = item->text();
+    QString fileName = index.data(WeldListModel::RelativePathRole).toString();
     QString fullPath = getDataFolderPath() + "/" + fileName;
 
-    QPixmap image(fullPath);
-    if (image.isNull()) {
-        QMessageBox::warning(this, "Image Load Error", "Failed to load image.");
-        return;
+    quint32 id = recordTable.idOf(fileName);
+    qint64 mtimeMs = id != WeldRecordTable::kInvalidId ? recordTable.mtimeMs(id) : 0;
+    QSize labelSize = ui->weldImageLabel->size();
+    ui->weldImageLabel->setAlignment(Qt::AlignCenter);
+    shownImagePath = fullPath;
+    shownImageMtimeMs = mtimeMs;
+
+    QImage cached;
+    if (show_pyramid(fullPath, mtimeMs)) {
+        // Tiles are drawn as they come into view; nothing to decode up front
+    } else if (imageLoader->cachedImage(fullPath, mtimeMs, labelSize, &cached)) {
+        // A weld looked at recently is shown straight away
+        imageLoader->cancelAll();
+        activeImageGeneration = 0;
+        ui->weldImageLabel->setPixmap(QPixmap::fromImage(cached));
+    } else {
+        // Decoding a large capture takes a while; a newer click supersedes this one
+        ui->weldImageLabel->setText("Loading image...");
+        activeImageGeneration = imageLoader->load(fullPath, mtimeMs, labelSize);
+        // An image too large for one pixmap gets tiles in the background; the builder skips others
+        pyramidBuilder->build(fullPath, mtimeMs);
     }
+    prefetch_neighbors(index.row(), labelSize);
 
-    // Scale 2× first
-    QSize doubleSize = image.size() * 2;
+    //Get the .txt file content corresponding to the name of the .jpg file
+    load_text_from_file(sidecarPathFor(fullPath));
+}
 
-    // Get QLabel size
-    QSize labelSize = ui->weldImageLabel->size();
+// The operator nearly always looks at the next or previous weld after this one
+void MainWindow::prefetch_neighbors(int row, const QSize &labelSize) {
+    int rows = appSettings().value("imageCache/prefetchRows", 2).toInt();
+    QVector<ImageRequest> requests;
+    for (int distance = 1; distance <= rows; ++distance) {
+        for (int neighbor : {row + distance, row - distance}) {
+            if (neighbor < 0 || neighbor >= weldListModel->recordCount())
+                continue;
+            quint32 id = weldListModel->idAt(neighbor);
+            ImageRequest request;
+            request.path = getDataFolderPath() + "/" + recordTable.fileName(id);
+            request.mtimeMs = recordTable.mtimeMs(id);
+            request.labelSize = labelSize;
+            requests.append(request);
+        }
+    }
+    imageLoader->prefetch(requests);
+}
 
-    // Determine final size: use 2× if it fits, otherwise fit to label
-    QSize finalSize;
-    if (doubleSize.width() <= labelSize.width() && doubleSize.height() <= labelSize.height()) {
-        finalSize = doubleSize;
-    } else {
-        finalSize = labelSize;
+// The tiled view replaces weldImageLabel while the image has a pyramid
+bool MainWindow::show_pyramid(const QString &imagePath, qint64 mtimeMs) {
+    if (!pyramidView->open(pyramidBuilder->pyramidPath(imagePath, mtimeMs))) {
+        pyramidView->close();
+        pyramidView->hide();
+        return false;
     }
+    imageLoader->cancelAll();
+    activeImageGeneration = 0;
+    ui->weldImageLabel->clear();
+    pyramidView->show();
+    pyramidView->raise();
+    return true;
+}
 
-    QPixmap scaledImage = image.scaled(finalSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+// Images that arrive by a scan get their tiles before anyone clicks them.
+// Files under pyramids/minFileBytes are seldom past PyramidBuilder::kMinSide
+// and are not queued, so a first scan of a large folder does not queue every
+// record; a click still builds for any size.
+void MainWindow::queue_pyramids(const QVector<WeldRecord> &records) {
+    qint64 minBytes = appSettings().value("pyramids/minFileBytes", 2 * 1024 * 1024).toLongLong();
+    const QString dataFolder = getDataFolderPath();
+    for (const WeldRecord &record : records) {
+        if (record.size >= minBytes)
+            pyramidBuilder->build(dataFolder + "/" + record.fileName, record.mtimeMs);
+    }
+}
 
-    // Display
-    ui->weldImageLabel->setAlignment(Qt::AlignCenter);
-    ui->weldImageLabel->setPixmap(scaledImage);
+void MainWindow::show_built_pyramid(const QString &imagePath) {
+    if (imagePath == shownImagePath)
+        show_pyramid(imagePath, shownImageMtimeMs);
+}
 
-    //Get the .txt file content corresponding to the name of the .jpg file
-    QString baseName = QFileInfo(fileName).completeBaseName();  // "cat.jpg" -> "cat"
-    QString textPath = getDataFolderPath() + "/" + baseName+ ".jpg" + ".txt";
-    load_text_from_file(textPath);
+void MainWindow::show_image(const ImageRequest &request, const QImage &image) {
+    if (request.generation != activeImageGeneration)
+        return;  // the operator has clicked another file since
+    ui->weldImageLabel->setPixmap(QPixmap::fromImage(image));
+}
+
+void MainWindow::show_image_error(const ImageRequest &request, const QString &error) {
+    if (request.generation != activeImageGeneration)
+        return;
+    qWarning() << "Failed to load" << request.path << ":" << error;
+    ui->weldImageLabel->setText("Image here");
+    QMessageBox::warning(this, "Image Load Error", "Failed to load image.");
 }
 
 void MainWindow::load_text_from_file(const QString &filePath) {
@@ -173,23 +460,278 @@ void MainWindow::load_text_from_file(const QString &filePath) {
 }
 
 void MainWindow::update_file_list() {
-    QString dataPath = getDataFolderPath();
-    QDir dir(dataPath);
-    QStringList nameFilters;
-    nameFilters << "*.jpg" << "*.JPG";
+    // On a first run there is no catalog yet, so the list is streamed in as the scan
+    // delivers it. Otherwise only the final snapshot is needed to diff against the table.
+    start_list_scan(recordTable.count() == 0);
+}
 
-    QFileInfoList allFiles = dir.entryInfoList(nameFilters, QDir::Files | QDir::NoDotAndDotDot);
+void MainWindow::start_list_scan(bool streamBatches) {
+    ScanRequest request;
+    request.folderPath = getDataFolderPath();
+    request.nameFilters = getImageNameFilters();
+    request.streamBatches = streamBatches;
+    if (weldCatalog)
+        request.known = weldCatalog->records();
 
-    // Sort newest first
-    std::sort(allFiles.begin(), allFiles.end(), [](const QFileInfo &a, const QFileInfo &b) {
-        return a.lastModified() > b.lastModified(); // descending
-    });
+    scanTouchedNames.clear();
+    activeScanGeneration = folderScanner->requestScan(request);
+}
+
+void MainWindow::show_catalog_records() {
+    QVector<WeldRecord> records;
+    records.reserve(weldCatalog->records().size());
+    for (const WeldRecord &record : weldCatalog->records().records())
+        records.append(record);
+
+    // The table radix sorts the batch by mtime; no comparator sort needed here
+    QVector<quint32> ids = recordTable.insertBatch(records);
+    searchEngine.addRecords(ids);
+    request_sidecars(ids);
+    searchCache.invalidate();
+    apply_search(ui->weldSearchTypeBox->text().trimmed());
+}
+
+// New records go into the table and the search index, and into the list if they match
+void MainWindow::insert_records(const QVector<WeldRecord> &records) {
+    QVector<quint32> ids = recordTable.insertBatch(records);
+    searchEngine.addRecords(ids);
+    request_sidecars(ids);
+    searchCache.invalidate();
+
+    if (activeQuery.error.isEmpty())
+        weldListModel->recordsInserted(searchEngine.filter(ids, activeQuery));
+}
+
+// A search reads copies of the table and the index. Changing the originals
+// while it runs would detach them, deep-copying every column and the whole
+// index on the GUI thread, so changes wait, in order, for it to finish.
+bool MainWindow::defer_while_searching(const std::function<void()> &change) {
+    if (!activeSearchGeneration)
+        return false;
+    deferredChanges.append(change);
+    return true;
+}
+
+void MainWindow::apply_deferred_changes() {
+    // The results may have started a fuzzy serial search; they wait for that too
+    if (activeSearchGeneration)
+        return;
+    QVector<std::function<void()>> changes;
+    changes.swap(deferredChanges);
+    for (const std::function<void()> &change : changes)
+        change();
+}
+
+void MainWindow::request_sidecars(const QVector<quint32> &ids) {
+    QStringList fileNames;
+    fileNames.reserve(ids.size());
+    for (quint32 id : ids)
+        fileNames.append(recordTable.fileName(id));
+    sidecarIndexer->requestSidecars(getDataFolderPath(), fileNames);
+}
+
+void MainWindow::index_sidecars(const QVector<SidecarText> &sidecars) {
+    if (defer_while_searching([this, sidecars]() { index_sidecars(sidecars); }))
+        return;
+
+    QVector<quint32> ids;
+    ids.reserve(sidecars.size());
+    for (const SidecarText &sidecar : sidecars) {
+        quint32 id = recordTable.idOf(sidecar.fileName);
+        if (id == WeldRecordTable::kInvalidId)
+            continue;  // removed while its sidecar was being read
+        searchEngine.addSidecar(id, sidecar.words);
+        ids.append(id);
+    }
+    // Cached results of free text may now miss records
+    if (!ids.isEmpty())
+        searchCache.invalidate();
+
+    // Records that only match by their sidecar join an active search
+    if (activeQuery.text.isEmpty() || !activeQuery.error.isEmpty())
+        return;
+    QVector<quint32> matches;
+    for (quint32 id : searchEngine.filter(ids, activeQuery)) {
+        if (!weldListModel->containsRecord(id))
+            matches.append(id);
+    }
+    weldListModel->recordsInserted(matches);
+}
 
-    ui->weldImageList->clear();
+void MainWindow::show_scan_batch(const ScanRequest &request, const QVector<WeldRecord> &records) {
+    if (defer_while_searching([this, request, records]() { show_scan_batch(request, records); }))
+        return;
+    if (request.generation != activeScanGeneration)
+        return;  // a newer scan has been requested since
+
+    // First run: fill the table as the scan streams in; the final diff then finds nothing new
+    QVector<WeldRecord> fresh;
+    fresh.reserve(records.size());
+    for (const WeldRecord &record : records) {
+        if (recordTable.idOf(record.fileName) == WeldRecordTable::kInvalidId
+                && !scanTouchedNames.contains(record.fileName))
+            fresh.append(record);
+    }
+    insert_records(fresh);
+    queue_pyramids(fresh);
+}
+
+void MainWindow::finish_scan(const ScanRequest &request, const FolderSnapshot &scanned) {
+    if (defer_while_searching([this, request, scanned]() { finish_scan(request, scanned); }))
+        return;
+    if (request.generation != activeScanGeneration)
+        return;
+    activeScanGeneration = 0;
+
+    // The watcher saw these after the walker may have listed their directory: its view is newer
+    FolderSnapshot snapshot = scanned;
+    for (const QString &fileName : scanTouchedNames) {
+        snapshot.remove(fileName);
+        quint32 id = recordTable.idOf(fileName);
+        if (id != WeldRecordTable::kInvalidId)
+            snapshot.insert(recordTable.record(id));
+    }
+    scanTouchedNames.clear();
+
+    if (weldCatalog)
+        weldCatalog->reconcile(snapshot);
+
+    // The first full scan completes startup; only now does the S3 sync begin
+    StartupProfiler::end(StartupProfiler::ScanPhase);
+    if (!syncTimer->isActive())
+        syncTimer->start(1000);  // Every 1 second
+
+    if (folderWatcher) {
+        QStringList watched = folderWatcher->directories();
+        for (const QString &directory : snapshot.directories()) {
+            if (!watched.contains(directory))
+                folderWatcher->addPath(directory);
+        }
+    }
+
+    FolderDiff diff = recordTable.diff(snapshot);
+    if (!diff.isEmpty())
+        apply_diff_to_list(diff);
+    queue_pyramids(diff.inserted);
+
+    if (request.streamBatches) {
+        qint64 listBytes = recordTable.memoryBytes() + weldListModel->memoryBytes();
+        qDebug() << "Weld records:" << recordTable.count() << "records,"
+                 << listBytes << "bytes in the table and list ("
+                 << (recordTable.count() ? listBytes / recordTable.count() : 0)
+                 << "per record)," << searchEngine.memoryBytes() << "bytes in the search index";
+    }
+}
+
+void MainWindow::ingest_record(const QString &imagePath) {
+    if (defer_while_searching([this, imagePath]() { ingest_record(imagePath); }))
+        return;
+    QFileInfo info(imagePath);
+    WeldRecord record;
+    record.fileName = QDir(getDataFolderPath()).relativeFilePath(imagePath);
+    record.size = info.size();
+    record.mtimeMs = info.lastModified().toMSecsSinceEpoch();
+    record.parseFileName();
+    QFileInfo sidecarInfo(sidecarPathFor(imagePath));
+    if (sidecarInfo.exists())
+        record.sidecarMtimeMs = sidecarInfo.lastModified().toMSecsSinceEpoch();
+    record.defectType = readDefectType(sidecarInfo.filePath());
+    if (activeScanGeneration)
+        scanTouchedNames.insert(record.fileName);
+
+    FolderDiff diff;
+    quint32 id = recordTable.idOf(record.fileName);
+    if (id != WeldRecordTable::kInvalidId) {
+        // A rewritten sidecar comes through here too; re-inserting reads its words again
+        WeldRecord known = recordTable.record(id);
+        if (known.sameFileAs(record) && known.defectType == record.defectType)
+            return;
+        diff.removed.append(known);
+    }
+    diff.inserted.append(record);
+    apply_diff_to_list(diff);
+    pyramidBuilder->build(imagePath, record.mtimeMs);
+
+    if (weldCatalog)
+        weldCatalog->upsert(record);
+}
+
+void MainWindow::drop_record(const QString &imagePath) {
+    if (defer_while_searching([this, imagePath]() { drop_record(imagePath); }))
+        return;
+    QString fileName = QDir(getDataFolderPath()).relativeFilePath(imagePath);
+    if (activeScanGeneration)
+        scanTouchedNames.insert(fileName);
+    quint32 id = recordTable.idOf(fileName);
+    if (id == WeldRecordTable::kInvalidId)
+        return;
+
+    FolderDiff diff;
+    diff.removed.append(recordTable.record(id));
+    apply_diff_to_list(diff);
+
+    if (weldCatalog)
+        weldCatalog->remove(fileName);
+}
+
+QString MainWindow::current_file_name() const {
+    QModelIndex current = ui->weldImageList->currentIndex();
+    if (!current.isValid() || !(current.flags() & Qt::ItemIsSelectable))
+        return QString();
+    return current.data(WeldListModel::RelativePathRole).toString();
+}
+
+void MainWindow::select_file(const QString &fileName) {
+    if (fileName.isEmpty())
+        return;
+    quint32 id = recordTable.idOf(fileName);
+    if (id == WeldRecordTable::kInvalidId)
+        return;
+    int row = weldListModel->rowOf(id);
+    if (row >= 0)
+        ui->weldImageList->setCurrentIndex(weldListModel->index(row));
+}
 
-    for (const QFileInfo &file : allFiles) {
-        ui->weldImageList->addItem(file.fileName());
+void MainWindow::apply_diff_to_list(const FolderDiff &diff) {
+    QListView *list = ui->weldImageList;
+    QScrollBar *scrollBar = list->verticalScrollBar();
+
+    // Remember what the operator is looking at so a refresh does not move it
+    QString selectedName = current_file_name();
+    bool atTop = scrollBar->value() == scrollBar->minimum();
+    QPersistentModelIndex topAnchor(list->indexAt(QPoint(0, 0)));
+
+    list->setUpdatesEnabled(false);
+
+    // Removed as one batch: a cleanup of thousands of files is one pass over each view
+    QSet<quint32> removedIds;
+    for (const WeldRecord &record : diff.removed) {
+        quint32 id = recordTable.idOf(record.fileName);
+        if (id != WeldRecordTable::kInvalidId)
+            removedIds.insert(id);
+    }
+    if (!removedIds.isEmpty()) {
+        weldListModel->recordsAboutToBeRemoved(removedIds);
+        for (quint32 id : removedIds)
+            searchEngine.removeRecord(id);
+        recordTable.removeBatch(removedIds);
+        searchCache.invalidate();
+    }
+
+    insert_records(diff.inserted);
+
+    // Rows that were not touched keep their selection through the model's persistent
+    // indexes; a changed file is removed and re-inserted, so restore it by name
+    if (!selectedName.isEmpty() && current_file_name() != selectedName)
+        select_file(selectedName);
+
+    if (atTop) {
+        scrollBar->setValue(scrollBar->minimum());
+    } else if (topAnchor.isValid()) {
+        list->scrollTo(topAnchor, QAbstractItemView::PositionAtTop);
     }
+
+    list->setUpdatesEnabled(true);
 }
 
 void MainWindow::sync_data_S3_to_local() {
@@ -204,6 +746,9 @@ void MainWindow::sync_data_S3_to_local() {
     // Stop and delete the process when it finishes
     connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             process, &QObject::deleteLater);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), []() {
+        StartupProfiler::end(StartupProfiler::FirstSyncPhase);
+    });
 
     // Optional: capture stdout and stderr for debugging
     connect(process, &QProcess::readyReadStandardOutput, [process]() {
@@ -217,6 +762,7 @@ void MainWindow::sync_data_S3_to_local() {
     connect(qApp, &QCoreApplication::aboutToQuit, process, &QProcess::kill);
 
     qDebug() << "Executing: aws" << args;
+    StartupProfiler::begin(StartupProfiler::FirstSyncPhase);
     process->start("aws", args);
 }
 
@@ -237,14 +783,15 @@ void MainWindow::on_clearDataButton_clicked() {
     if (reply != QMessageBox::Yes)
         return;
     QStringList filters = {"*.jpg", "*.jpeg", "*.txt", "*.png"};  // Add more if needed
-    QFileInfoList fileList = dir.entryInfoList(filters, QDir::Files);
+    // Images sit in shard subdirectories as well as the root
+    QDirIterator it(folderPath, filters, QDir::Files | QDir::NoSymLinks, QDirIterator::Subdirectories);
 
     int deletedCount = 0;
-    for (const QFileInfo &fileInfo : fileList) {
-        QFile::remove(fileInfo.absoluteFilePath());
-        ++deletedCount;
+    while (it.hasNext()) {
+        if (QFile::remove(it.next()))
+            ++deletedCount;
     }
 
-    update_file_list(); // Refresh the UI list
+    update_file_list(); // Rescan so the list drops everything that went
     QMessageBox::information(this, "Done", QString("Deleted %1 file(s).").arg(deletedCount));
 }
@@ -7,11 +7,33 @@
 #include <QMessageBox>
 #include <QCoreApplication>
 #include <QString>
-#include <QListWidgetItem>
+#include <QModelIndex>
 #include <QFileSystemWatcher>
 #include <QScreen>
 #include <QProcess>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QSet>
+
+#include <functional>
+
+#include "changecoalescer.h"
+#include "folderscanner.h"
+#include "imageloader.h"
+#include "inotifywatcher.h"
+#include "pyramidbuilder.h"
+#include "pyramidview.h"
+#include "searchresultcache.h"
+#include "searchrunner.h"
+#include "sidecarindexer.h"
+#include "thumbnailloader.h"
+#include "foldersnapshot.h"
+#include "weldcatalog.h"
+#include "weldingesttracker.h"
+#include "weldlistmodel.h"
+#include "weldrecordtable.h"
+#include "weldsearchengine.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -27,16 +49,78 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
 private slots:
     void on_searchButton_clicked();
     void on_clearDataButton_clicked();
-    void on_fileItem_clicked(QListWidgetItem *item);
+    void show_current_file(const QModelIndex &current);
+    void on_fileItem_clicked(const QModelIndex &index);
     void load_text_from_file(const QString &filePath);
+    void show_scan_batch(const ScanRequest &request, const QVector<WeldRecord> &records);
+    void finish_scan(const ScanRequest &request, const FolderSnapshot &scanned);
+    void ingest_record(const QString &imagePath);
+    void drop_record(const QString &imagePath);
+    void start_deferred_startup();
+    void show_search_results();
+    void index_sidecars(const QVector<SidecarText> &sidecars);
+    void show_first_results(quint64 generation, const QVector<quint32> &ids);
+    void finish_search(quint64 generation, const QVector<quint32> &ids);
+    void show_image(const ImageRequest &request, const QImage &image);
+    void show_image_error(const ImageRequest &request, const QString &error);
+    void show_built_pyramid(const QString &imagePath);
 
 private:
     Ui::MainWindow *ui;
-    QFileSystemWatcher *folderWatcher;
+    QFileSystemWatcher *folderWatcher = nullptr;
+    InotifyWatcher *inotifyWatcher = nullptr;
+    WeldIngestTracker *ingestTracker = nullptr;
+    ChangeCoalescer *changeCoalescer;
+    QTimer *syncTimer;
+    bool startupStarted = false;
+    WeldCatalog *weldCatalog = nullptr;
+    WeldRecordTable recordTable;                     // every record in the data folder
+    WeldSearchEngine searchEngine{&recordTable};     // answers searches without touching the disk
+    WeldListModel *weldListModel;
+    ThumbnailLoader *thumbnailLoader;
+    QString activeSearchText;                        // what the list is filtered by, empty for all
+    WeldQuery activeQuery;                           // activeSearchText, parsed
+    SearchRunner *searchRunner;
+    quint64 activeSearchGeneration = 0;              // 0 while no search is running
+    QVector<std::function<void()>> deferredChanges;  // table and index changes held back until it finishes
+    SearchResultCache searchCache;                   // lets a longer query narrow down a shorter one's results
+    quint64 searchCacheVersion = 0;                  // searchCache.version() the running search started from
+    QString searchSelection;                         // selected file the first results left out
+    QElapsedTimer searchTimer;
+    QThread scannerThread;
+    FolderScanner *folderScanner;
+    quint64 activeScanGeneration = 0;                // 0 while no scan is running
+    QSet<QString> scanTouchedNames;                  // changed by the watcher while the scan ran
+    ImageLoader *imageLoader;
+    quint64 activeImageGeneration = 0;               // the click weldImageLabel is waiting for
+    PyramidBuilder *pyramidBuilder;
+    PyramidView *pyramidView;                        // in place of weldImageLabel for very large images
+    QString shownImagePath;
+    qint64 shownImageMtimeMs = 0;
+    QThread indexerThread;
+    SidecarIndexer *sidecarIndexer;
     void update_file_list();  // reuse for both startup and refresh
+    void start_list_scan(bool streamBatches);
+    void apply_search(const QString &searchText);
+    void start_search();
+    void show_found_records(const QVector<quint32> &ids);
+    void show_catalog_records();
+    void insert_records(const QVector<WeldRecord> &records);
+    void request_sidecars(const QVector<quint32> &ids);
+    bool defer_while_searching(const std::function<void()> &change);
+    void apply_deferred_changes();
+    void apply_diff_to_list(const FolderDiff &diff);
+    QString current_file_name() const;
+    void select_file(const QString &fileName);
+    void prefetch_neighbors(int row, const QSize &labelSize);
+    bool show_pyramid(const QString &imagePath, qint64 mtimeMs);
+    void queue_pyramids(const QVector<WeldRecord> &records);
     void sync_data_S3_to_local();
 };
 #endif // MAINWINDOW_H
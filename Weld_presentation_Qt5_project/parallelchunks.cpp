@@ -0,0 +1,72 @@
+#include "parallelchunks.h"
+
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+
+#include "pooltask.h"
+
+namespace {
+
+// Shared with the pool tasks, which may start after the run has finished;
+// such late tasks find no chunk left and return without touching the body
+struct ChunkState
+{
+    ParallelChunks::Body body;
+    int items = 0;
+    int chunks = 0;
+    std::atomic<int> nextChunk{0};
+    QMutex mutex;
+    QWaitCondition allDone;
+    int doneChunks = 0;
+
+    void work()
+    {
+        for (;;) {
+            int chunk = nextChunk.fetch_add(1);
+            if (chunk >= chunks)
+                return;
+            body(chunk, int(qint64(items) * chunk / chunks), int(qint64(items) * (chunk + 1) / chunks));
+
+            QMutexLocker locker(&mutex);
+            if (++doneChunks == chunks)
+                allDone.wakeAll();
+        }
+    }
+};
+
+}  // namespace
+
+ParallelChunks::ParallelChunks(int itemCount, int minChunkSize)
+    : items(itemCount)
+{
+    // A few chunks per thread, so an uneven chunk does not hold up the rest
+    int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    chunks = qBound(1, itemCount / qMax(1, minChunkSize), threads * 4);
+}
+
+void ParallelChunks::run(const Body &body) const
+{
+    if (chunks == 1) {
+        body(0, 0, items);
+        return;
+    }
+
+    auto state = std::make_shared<ChunkState>();
+    state->body = body;
+    state->items = items;
+    state->chunks = chunks;
+
+    int helpers = qMin(QThreadPool::globalInstance()->maxThreadCount(), chunks) - 1;
+    for (int i = 0; i < helpers; ++i)
+        startInPool(*QThreadPool::globalInstance(), [state]() { state->work(); });
+
+    state->work();
+
+    QMutexLocker locker(&state->mutex);
+    while (state->doneChunks < state->chunks)
+        state->allDone.wait(&state->mutex);
+}
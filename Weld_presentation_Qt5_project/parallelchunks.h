@@ -0,0 +1,25 @@
+#ifndef PARALLELCHUNKS_H
+#define PARALLELCHUNKS_H
+
+#include <functional>
+
+// Splits [0, itemCount) into numbered chunks and runs them on the global
+// thread pool, the calling thread included, returning once all are done.
+// Chunks keep their order, so per-chunk results can be joined in order.
+// Small inputs run as a single chunk on the calling thread.
+class ParallelChunks
+{
+public:
+    using Body = std::function<void(int chunk, int begin, int end)>;
+
+    explicit ParallelChunks(int itemCount, int minChunkSize = 16384);
+
+    int chunkCount() const { return chunks; }
+    void run(const Body &body) const;
+
+private:
+    int items;
+    int chunks;
+};
+
+#endif // PARALLELCHUNKS_H
@@ -0,0 +1,199 @@
+#include "parallelwalker.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+const int kStopCheckInterval = 1024;
+
+struct WorkQueue
+{
+    QMutex mutex;
+    QStringList directories;
+};
+
+struct WorkerResult
+{
+    QVector<WeldRecord> records;
+    QStringList directories;
+};
+}
+
+ParallelWalker::ParallelWalker(const QString &root, const QStringList &nameFilters)
+    : rootPath(QDir::cleanPath(root))
+    , threadCount(QThread::idealThreadCount())
+{
+    // Name filters are plain "*.ext" patterns
+    for (const QString &filter : nameFilters)
+        suffixes.append(filter.mid(filter.lastIndexOf('*') + 1).toLower());
+    suffixes.removeDuplicates();
+}
+
+bool ParallelWalker::matchesFilters(const QString &fileName) const
+{
+    for (const QString &suffix : suffixes) {
+        if (fileName.endsWith(suffix, Qt::CaseInsensitive))
+            return true;
+    }
+    return false;
+}
+
+bool ParallelWalker::walk(const Visitor &visit, const StopCheck &stopRequested)
+{
+    const int workers = qMax(1, threadCount);
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (int i = 0; i < workers; ++i)
+        queues.emplace_back(new WorkQueue);
+    std::vector<WorkerResult> results(workers);
+
+    // Directories queued or being read. The walk is over when it drops to zero.
+    std::atomic<int> pendingDirectories{1};
+    std::atomic<bool> stopped{false};
+    queues[0]->directories.append(rootPath);
+
+    // Idle workers sleep until a directory is queued or the walk ends.
+    // workEpoch counts queued directories, so one queued between a failed
+    // steal and the wait is not missed.
+    QMutex idleMutex;
+    QWaitCondition workChanged;
+    quint64 workEpoch = 0;
+    auto wake = [&](bool all) {
+        {
+            QMutexLocker lock(&idleMutex);
+            ++workEpoch;
+        }
+        if (all)
+            workChanged.wakeAll();
+        else
+            workChanged.wakeOne();
+    };
+
+    const int rootPrefix = rootPath.size() + 1;
+
+    auto takeWork = [&](int self, QString &directory) {
+        {
+            QMutexLocker lock(&queues[self]->mutex);
+            if (!queues[self]->directories.isEmpty()) {
+                directory = queues[self]->directories.takeLast();  // own work: depth first
+                return true;
+            }
+        }
+        for (int offset = 1; offset < workers; ++offset) {
+            WorkQueue &victim = *queues[(self + offset) % workers];
+            QMutexLocker lock(&victim.mutex);
+            if (!victim.directories.isEmpty()) {
+                directory = victim.directories.takeFirst();  // steal the oldest, usually the largest subtree
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto work = [&](int self) {
+        WorkerResult &result = results[self];
+        int sinceStopCheck = 0;
+        QString directory;
+
+        while (pendingDirectories.load() > 0 && !stopped.load()) {
+            quint64 seenEpoch;
+            {
+                QMutexLocker lock(&idleMutex);
+                seenEpoch = workEpoch;
+            }
+            if (!takeWork(self, directory)) {
+                // Others are still reading; more may be queued soon
+                QMutexLocker lock(&idleMutex);
+                while (workEpoch == seenEpoch && pendingDirectories.load() > 0 && !stopped.load())
+                    workChanged.wait(&idleMutex);
+                continue;
+            }
+
+            result.directories.append(directory);
+            // Images are visited once the whole directory is listed, when their sidecars are known
+            QVector<WeldRecord> pending;
+            QStringList pendingPaths;
+            QHash<QString, qint64> sidecarMtimes;
+            QDirIterator it(directory, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+            while (it.hasNext()) {
+                it.next();
+                if (++sinceStopCheck % kStopCheckInterval == 0 && stopRequested()) {
+                    stopped = true;
+                    wake(true);
+                    break;
+                }
+
+                const QFileInfo file = it.fileInfo();
+                if (file.isDir()) {
+                    if (file.isSymLink())
+                        continue;  // could loop back into the tree
+                    ++pendingDirectories;
+                    {
+                        QMutexLocker lock(&queues[self]->mutex);
+                        queues[self]->directories.append(file.filePath());
+                    }
+                    wake(false);
+                    continue;
+                }
+                if (file.fileName().endsWith(".txt")) {
+                    sidecarMtimes.insert(file.fileName(), file.lastModified().toMSecsSinceEpoch());
+                    continue;
+                }
+                if (!matchesFilters(file.fileName()))
+                    continue;
+
+                WeldRecord record;
+                record.fileName = file.filePath().mid(rootPrefix);
+                record.size = file.size();
+                record.mtimeMs = file.lastModified().toMSecsSinceEpoch();
+                pending.append(record);
+                pendingPaths.append(file.filePath());
+            }
+
+            for (int i = 0; i < pending.size() && !stopped.load(); ++i) {
+                // Same precedence as sidecarPathFor(): "<name>.jpg.txt", then "<name>.txt"
+                WeldRecord &record = pending[i];
+                const QFileInfo image(pendingPaths.at(i));
+                auto sidecar = sidecarMtimes.constFind(image.fileName() + ".txt");
+                if (sidecar == sidecarMtimes.constEnd())
+                    sidecar = sidecarMtimes.constFind(image.completeBaseName() + ".txt");
+                if (sidecar != sidecarMtimes.constEnd())
+                    record.sidecarMtimeMs = sidecar.value();
+                if (visit(record, pendingPaths.at(i)))
+                    result.records.append(record);
+            }
+            if (--pendingDirectories == 0)
+                wake(true);
+        }
+    };
+
+    QVector<QThread *> threads;
+    for (int i = 1; i < workers; ++i) {
+        QThread *thread = QThread::create(work, i);
+        thread->start();
+        threads.append(thread);
+    }
+    work(0);  // the calling thread takes a share too
+    for (QThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    foundRecords.clear();
+    foundDirectories.clear();
+    for (const WorkerResult &result : results) {
+        foundRecords += result.records;
+        foundDirectories += result.directories;
+    }
+    return !stopped.load() && !stopRequested();
+}
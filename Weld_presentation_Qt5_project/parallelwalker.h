@@ -0,0 +1,44 @@
+#ifndef PARALLELWALKER_H
+#define PARALLELWALKER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+#include "weldrecord.h"
+
+// Walks a directory tree on several threads at once.
+// Each thread works through its own queue of directories and steals from the
+// others when it runs dry, so one large shard does not leave the rest idle.
+class ParallelWalker
+{
+public:
+    // Called on a worker thread for every matching file. The record has its
+    // path relative to the root, size and mtime filled in, and the mtime of
+    // its sidecar if the directory holds one; return false to drop it.
+    using Visitor = std::function<bool(WeldRecord &record, const QString &absolutePath)>;
+    using StopCheck = std::function<bool()>;
+
+    ParallelWalker(const QString &root, const QStringList &nameFilters);
+
+    void setThreadCount(int count) { threadCount = qMax(1, count); }
+
+    // Returns false if stopRequested() ended the walk early
+    bool walk(const Visitor &visit, const StopCheck &stopRequested);
+
+    const QVector<WeldRecord> &records() const { return foundRecords; }
+    const QStringList &directories() const { return foundDirectories; }
+
+private:
+    bool matchesFilters(const QString &fileName) const;
+
+    QString rootPath;
+    QStringList suffixes;
+    int threadCount;
+    QVector<WeldRecord> foundRecords;
+    QStringList foundDirectories;
+};
+
+#endif // PARALLELWALKER_H
@@ -0,0 +1,30 @@
+#ifndef POOLTASK_H
+#define POOLTASK_H
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <functional>
+#include <utility>
+
+// Runs body on one of pool's threads. Qt 5.15 takes a std::function itself;
+// older versions get it wrapped in a self-deleting QRunnable.
+inline void startInPool(QThreadPool &pool, std::function<void()> body)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    pool.start(std::move(body));
+#else
+    class Task : public QRunnable
+    {
+    public:
+        explicit Task(std::function<void()> body) : body(std::move(body)) {}
+        void run() override { body(); }
+
+    private:
+        std::function<void()> body;
+    };
+    pool.start(new Task(std::move(body)));
+#endif
+}
+
+#endif // POOLTASK_H
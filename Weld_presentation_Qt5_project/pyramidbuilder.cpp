@@ -0,0 +1,70 @@
+#include "pyramidbuilder.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "diagnostics.h"
+#include "pooltask.h"
+#include "tilepyramid.h"
+
+PyramidBuilder::PyramidBuilder(const QString &cacheDirectory, QObject *parent)
+    : QObject(parent)
+    , cacheDirectory(cacheDirectory)
+{
+    buildPool.setMaxThreadCount(1);
+}
+
+PyramidBuilder::~PyramidBuilder()
+{
+    stopping = true;
+    buildPool.clear();
+    buildPool.waitForDone();
+}
+
+QString PyramidBuilder::pyramidPath(const QString &imagePath, qint64 mtimeMs) const
+{
+    QByteArray hash = QCryptographicHash::hash(imagePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory + "/" + QString::fromLatin1(hash) + "-" + QString::number(mtimeMs) + ".pyr";
+}
+
+void PyramidBuilder::build(const QString &imagePath, qint64 mtimeMs)
+{
+    const QString path = pyramidPath(imagePath, mtimeMs);
+    {
+        QMutexLocker locker(&mutex);
+        if (queued.contains(path) || tooSmall.contains(path) || failed.contains(path) || QFile::exists(path))
+            return;
+        queued.insert(path);
+    }
+
+    startInPool(buildPool, [this, imagePath, path]() {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        QSize size = QImageReader(imagePath).size();
+        bool large = size.width() > kMinSide || size.height() > kMinSide;
+        bool built = false;
+        if (large) {
+            QElapsedTimer timer;
+            timer.start();
+            QDir().mkpath(cacheDirectory);
+            built = TilePyramid::build(imagePath, path, [this]() { return stopping.load(); });
+            if (built) {
+                qCDebug(weldDiagnostics) << "Built tile pyramid for" << imagePath << size << "in" << timer.elapsed() << "ms";
+                emit pyramidBuilt(imagePath);
+            } else if (!stopping) {
+                qWarning() << "Could not build tile pyramid for" << imagePath;
+            }
+        }
+        QMutexLocker locker(&mutex);
+        queued.remove(path);
+        if (!large && size.isValid())
+            tooSmall.insert(path);
+        else if (large && !built && !stopping)
+            failed.insert(path);  // tried again once the file changes, and with it the path
+    });
+}
@@ -0,0 +1,44 @@
+#ifndef PYRAMIDBUILDER_H
+#define PYRAMIDBUILDER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+
+// Builds TilePyramid files in the background for images too large to show
+// as one pixmap, one image at a time at low thread priority. Images below
+// kMinSide on both sides are left alone after a look at their header.
+class PyramidBuilder : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kMinSide = 8192;
+
+    PyramidBuilder(const QString &cacheDirectory, QObject *parent = nullptr);
+    ~PyramidBuilder();
+
+    // Where the pyramid of this version of the image is, or will be, kept
+    QString pyramidPath(const QString &imagePath, qint64 mtimeMs) const;
+    // Queues the image unless its pyramid exists, is queued already or
+    // could not be built for this version of the image
+    void build(const QString &imagePath, qint64 mtimeMs);
+
+signals:
+    void pyramidBuilt(const QString &imagePath);
+
+private:
+    QString cacheDirectory;
+    QMutex mutex;
+    QSet<QString> queued;
+    QSet<QString> tooSmall;  // pyramid paths of images that need none
+    QSet<QString> failed;    // and of images whose build failed
+    std::atomic<bool> stopping{false};
+    QThreadPool buildPool;
+};
+
+#endif // PYRAMIDBUILDER_H
@@ -0,0 +1,166 @@
+#include "pyramidview.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+
+#include <cmath>
+
+namespace {
+const int kTileCacheKilobytes = 64 * 1024;
+const double kMaxScale = 8.0;
+const QColor kBackground(0xcb, 0xc9, 0xcb);  // as weldImageLabel
+}
+
+PyramidView::PyramidView(QWidget *parent)
+    : QWidget(parent)
+    , tiles(kTileCacheKilobytes)
+{
+    setMouseTracking(false);
+    setCursor(Qt::OpenHandCursor);
+}
+
+bool PyramidView::open(const QString &pyramidPath)
+{
+    tiles.clear();
+    if (!pyramid.open(pyramidPath))
+        return false;
+    fitToView();
+    update();
+    return true;
+}
+
+void PyramidView::close()
+{
+    tiles.clear();
+    pyramid.close();
+    update();
+}
+
+void PyramidView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), kBackground);
+    if (!pyramid.isOpen())
+        return;
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+    // A level-L pixel covers 2^L full-size pixels
+    const int level = levelFor(scale);
+    const double levelScale = std::ldexp(1.0, level);
+    const QSize levelSize = pyramid.levelSize(level);
+    const double tileSpan = TilePyramid::kTileSize * levelScale;  // in full-size pixels
+
+    const QPointF viewEnd = origin + QPointF(width(), height()) / scale;
+    const int firstColumn = qMax(0, int(origin.x() / tileSpan));
+    const int firstRow = qMax(0, int(origin.y() / tileSpan));
+    const int lastColumn = qMin((levelSize.width() - 1) / TilePyramid::kTileSize, int(viewEnd.x() / tileSpan));
+    const int lastRow = qMin((levelSize.height() - 1) / TilePyramid::kTileSize, int(viewEnd.y() / tileSpan));
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            QImage tile = cachedTile(level, column, row);
+            if (tile.isNull())
+                continue;
+            QRectF target((column * tileSpan - origin.x()) * scale, (row * tileSpan - origin.y()) * scale,
+                          tile.width() * levelScale * scale, tile.height() * levelScale * scale);
+            painter.drawImage(target, tile);
+        }
+    }
+}
+
+void PyramidView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    if (pyramid.isOpen())
+        fitToView();
+}
+
+void PyramidView::wheelEvent(QWheelEvent *event)
+{
+    if (!pyramid.isOpen())
+        return;
+
+    // The image point under the cursor stays there
+    const QPointF cursor = event->position();
+    const QPointF anchor = origin + cursor / scale;
+    scale = qBound(fitScale(), scale * std::pow(1.0015, event->angleDelta().y()), kMaxScale);
+    origin = anchor - cursor / scale;
+    clampOrigin();
+    update();
+}
+
+void PyramidView::mousePressEvent(QMouseEvent *event)
+{
+    lastDragPos = event->pos();
+    setCursor(Qt::ClosedHandCursor);
+}
+
+void PyramidView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton) || !pyramid.isOpen())
+        return;
+    origin -= QPointF(event->pos() - lastDragPos) / scale;
+    lastDragPos = event->pos();
+    clampOrigin();
+    update();
+}
+
+void PyramidView::mouseDoubleClickEvent(QMouseEvent *)
+{
+    if (!pyramid.isOpen())
+        return;
+    fitToView();
+    update();
+}
+
+void PyramidView::fitToView()
+{
+    scale = fitScale();
+    origin = QPointF();
+    clampOrigin();
+}
+
+double PyramidView::fitScale() const
+{
+    const QSize size = pyramid.size();
+    if (size.isEmpty())
+        return 1.0;
+    return qMin(1.0, qMin(double(width()) / size.width(), double(height()) / size.height()));
+}
+
+// Keeps the image in view, centred along a side it does not fill
+void PyramidView::clampOrigin()
+{
+    const QSizeF viewSize = QSizeF(size()) / scale;
+    const QSize imageSize = pyramid.size();
+    if (viewSize.width() >= imageSize.width())
+        origin.setX((imageSize.width() - viewSize.width()) / 2);
+    else
+        origin.setX(qBound(0.0, origin.x(), imageSize.width() - viewSize.width()));
+    if (viewSize.height() >= imageSize.height())
+        origin.setY((imageSize.height() - viewSize.height()) / 2);
+    else
+        origin.setY(qBound(0.0, origin.y(), imageSize.height() - viewSize.height()));
+}
+
+// The coarsest level that still has a pixel for every screen pixel
+int PyramidView::levelFor(double viewScale) const
+{
+    int level = 0;
+    while (level + 1 < pyramid.levelCount() && std::ldexp(1.0, level + 1) * viewScale <= 1.0)
+        ++level;
+    return level;
+}
+
+QImage PyramidView::cachedTile(int level, int column, int row)
+{
+    const quint64 key = quint64(level) << 48 | quint64(column) << 24 | quint64(row);
+    if (QImage *tile = tiles.object(key))
+        return *tile;
+
+    QImage tile = pyramid.tile(level, column, row);
+    if (!tile.isNull())
+        tiles.insert(key, new QImage(tile), int(qint64(tile.bytesPerLine()) * tile.height() / 1024) + 1);
+    return tile;
+}
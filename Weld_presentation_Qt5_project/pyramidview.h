@@ -0,0 +1,49 @@
+#ifndef PYRAMIDVIEW_H
+#define PYRAMIDVIEW_H
+
+#include <QCache>
+#include <QImage>
+#include <QPoint>
+#include <QPointF>
+#include <QWidget>
+
+#include "tilepyramid.h"
+
+// Zoom and pan over a TilePyramid. Each paint picks the level closest to
+// the zoom (never coarser than the screen needs) and decodes only the tiles
+// in view; decoded tiles are kept in a cache of fixed size, so memory does
+// not grow with the image. Wheel zooms around the cursor, dragging pans,
+// double click fits the whole image again.
+class PyramidView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PyramidView(QWidget *parent = nullptr);
+
+    bool open(const QString &pyramidPath);
+    void close();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    void fitToView();
+    void clampOrigin();
+    double fitScale() const;
+    int levelFor(double viewScale) const;
+    QImage cachedTile(int level, int column, int row);
+
+    TilePyramid pyramid;
+    QCache<quint64, QImage> tiles;  // cost in kilobytes
+    double scale = 1.0;             // view pixels per full-size image pixel
+    QPointF origin;                 // full-size image point at the view's top left
+    QPoint lastDragPos;
+};
+
+#endif // PYRAMIDVIEW_H
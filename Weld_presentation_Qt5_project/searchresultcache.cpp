@@ -0,0 +1,77 @@
+#include "searchresultcache.h"
+
+#include <QStringList>
+
+SearchResultCache::Match SearchResultCache::lookup(const WeldQuery &query, QVector<quint32> &ids)
+{
+    const QString key = keyOf(query);
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries.at(i).key == key) {
+            touch(i);
+            ids = entries.first().ids;
+            ++counts.hits;
+            return Exact;
+        }
+    }
+
+    // Of the broader results, the smallest leaves the least to check
+    int best = -1;
+    for (int i = 0; i < entries.size(); ++i) {
+        if (query.narrows(entries.at(i).query) && (best < 0 || entries.at(i).ids.size() < entries.at(best).ids.size()))
+            best = i;
+    }
+    if (best < 0) {
+        ++counts.misses;
+        return Miss;
+    }
+    touch(best);
+    ids = entries.first().ids;
+    ++counts.refinements;
+    return Broader;
+}
+
+void SearchResultCache::insert(const WeldQuery &query, const QVector<quint32> &ids, quint64 version)
+{
+    if (version != currentVersion || ids.size() > kMaxIds)
+        return;
+
+    const QString key = keyOf(query);
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries.at(i).key == key) {
+            totalIds -= entries.at(i).ids.size();
+            entries.remove(i);
+            break;
+        }
+    }
+
+    entries.prepend(Entry{key, query, ids});
+    totalIds += ids.size();
+    while (entries.size() > kMaxEntries || totalIds > kMaxIds) {
+        totalIds -= entries.last().ids.size();
+        entries.removeLast();
+    }
+}
+
+void SearchResultCache::invalidate()
+{
+    ++currentVersion;
+    entries.clear();
+    totalIds = 0;
+}
+
+// Equal for queries that match the same records in the same order
+QString SearchResultCache::keyOf(const WeldQuery &query)
+{
+    return QStringList{query.part.value.toLower(), query.part.prefix ? "*" : "",
+                       query.serial.value.toLower(), query.serial.prefix ? "*" : "",
+                       QString::number(query.serialDistance), query.defect.toLower(),
+                       QString::number(query.sinceMs), QString::number(query.untilMs),
+                       query.text.toLower(), query.nameRegex.pattern(), QString::number(int(query.order))}
+        .join(QChar(0x1f));
+}
+
+void SearchResultCache::touch(int index)
+{
+    if (index > 0)
+        entries.prepend(entries.takeAt(index));
+}
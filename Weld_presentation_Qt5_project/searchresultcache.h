@@ -0,0 +1,59 @@
+#ifndef SEARCHRESULTCACHE_H
+#define SEARCHRESULTCACHE_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "weldquery.h"
+
+// Results of recent searches. Besides answering a repeated query outright,
+// it lets a query be answered from the results of an earlier, broader one:
+// typing "21146" after "2114" only checks the records "2114" found.
+// Least recently used results are dropped once the cache holds more than
+// kMaxIds ids. Any change to the records or their sidecars makes every
+// result stale; invalidate() drops them all, and results of searches that
+// started before it are not taken in.
+class SearchResultCache
+{
+public:
+    enum Match { Miss, Exact, Broader };
+
+    struct Stats
+    {
+        quint64 hits = 0;         // answered outright
+        quint64 refinements = 0;  // narrowed down from a broader result
+        quint64 misses = 0;
+    };
+
+    // Exact: ids are the query's results. Broader: ids hold all of them and more, unordered
+    Match lookup(const WeldQuery &query, QVector<quint32> &ids);
+    // version is the one the search started from
+    void insert(const WeldQuery &query, const QVector<quint32> &ids, quint64 version);
+    void invalidate();
+    quint64 version() const { return currentVersion; }
+
+    Stats stats() const { return counts; }
+    qint64 memoryBytes() const { return qint64(totalIds) * qint64(sizeof(quint32)); }
+
+private:
+    static const int kMaxIds = 4 * 1024 * 1024;
+    static const int kMaxEntries = 32;
+
+    struct Entry
+    {
+        QString key;
+        WeldQuery query;
+        QVector<quint32> ids;
+    };
+
+    static QString keyOf(const WeldQuery &query);
+    void touch(int index);
+
+    QVector<Entry> entries;  // most recently used first
+    int totalIds = 0;
+    quint64 currentVersion = 0;
+    Stats counts;
+};
+
+#endif // SEARCHRESULTCACHE_H
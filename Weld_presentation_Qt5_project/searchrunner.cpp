@@ -0,0 +1,84 @@
+#include "searchrunner.h"
+
+#include <functional>
+#include <memory>
+
+#include "pooltask.h"
+
+namespace {
+
+// More rows than weldImageList shows at once
+const int kFirstResults = 64;
+// Records the first results may look at; a few milliseconds of checking
+const int kFirstResultsBudget = 64 * 1024;
+
+struct SearchSnapshot
+{
+    SearchSnapshot(const WeldRecordTable &table, const WeldSearchEngine &engine)
+        : table(table)
+        , engine(engine)
+    {
+        this->engine.setTable(&this->table);
+    }
+
+    WeldRecordTable table;
+    WeldSearchEngine engine;
+};
+
+}  // namespace
+
+SearchRunner::SearchRunner(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<QVector<quint32>>("QVector<quint32>");
+    searchPool.setMaxThreadCount(2);
+}
+
+SearchRunner::~SearchRunner()
+{
+    cancelAll();
+    searchPool.waitForDone();
+}
+
+quint64 SearchRunner::start(const WeldRecordTable &table, const WeldSearchEngine &engine, const WeldQuery &query)
+{
+    return startTask(table, engine, query, QVector<quint32>(), false);
+}
+
+quint64 SearchRunner::startWithin(const WeldRecordTable &table, const WeldSearchEngine &engine, const WeldQuery &query,
+                                  const QVector<quint32> &candidates)
+{
+    return startTask(table, engine, query, candidates, true);
+}
+
+quint64 SearchRunner::startTask(const WeldRecordTable &table, const WeldSearchEngine &engine, const WeldQuery &query,
+                                const QVector<quint32> &candidates, bool within)
+{
+    const quint64 generation = ++latestGeneration;
+
+    // Sorting now, on the GUI thread, keeps the copies read-only
+    engine.sortPendingPostings();
+    auto snapshot = std::make_shared<SearchSnapshot>(table, engine);
+
+    startInPool(searchPool, [this, snapshot, query, candidates, within, generation]() {
+        if (isStale(generation))
+            return;
+        auto cancelled = [this, generation]() { return isStale(generation); };
+
+        // A selective query is answered quickly from an index anyway
+        QVector<quint32> first = snapshot->engine.firstMatches(query, kFirstResults, kFirstResultsBudget, cancelled);
+        if (first.size() == kFirstResults && !isStale(generation))
+            emit firstResultsFound(generation, first);
+
+        QVector<quint32> ids = within ? snapshot->engine.searchWithin(candidates, query, cancelled)
+                                      : snapshot->engine.search(query, cancelled);
+        if (!isStale(generation))
+            emit searchFinished(generation, ids);
+    });
+    return generation;
+}
+
+void SearchRunner::cancelAll()
+{
+    ++latestGeneration;
+}
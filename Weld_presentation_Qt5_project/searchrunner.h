@@ -0,0 +1,52 @@
+#ifndef SEARCHRUNNER_H
+#define SEARCHRUNNER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+
+#include "weldquery.h"
+#include "weldrecordtable.h"
+#include "weldsearchengine.h"
+
+// Runs searches off the GUI thread, against copies of the record table and
+// the search engine taken when the search starts. Copying is cheap (the data
+// is implicitly shared) as long as the originals are left alone until the
+// search is done; MainWindow holds its changes back until then.
+// Starting a search cancels the one before it: each search carries a
+// generation, and a search whose generation is no longer the latest stops at
+// its next check and reports nothing. A broad query reports its first
+// screenful of results before the full search has finished.
+class SearchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SearchRunner(QObject *parent = nullptr);
+    ~SearchRunner();
+
+    // Returns the generation searchFinished() will carry
+    quint64 start(const WeldRecordTable &table, const WeldSearchEngine &engine, const WeldQuery &query);
+    // Checks only candidates, the results of a broader query (see SearchResultCache)
+    quint64 startWithin(const WeldRecordTable &table, const WeldSearchEngine &engine, const WeldQuery &query,
+                        const QVector<quint32> &candidates);
+    void cancelAll();
+
+signals:
+    // The first results in their final order, for a query that matches many records
+    void firstResultsFound(quint64 generation, const QVector<quint32> &ids);
+    void searchFinished(quint64 generation, const QVector<quint32> &ids);
+
+private:
+    quint64 startTask(const WeldRecordTable &table, const WeldSearchEngine &engine, const WeldQuery &query,
+                      const QVector<quint32> &candidates, bool within);
+    bool isStale(quint64 generation) const { return generation != latestGeneration.load(); }
+
+    std::atomic<quint64> latestGeneration{0};
+    // Room for a new search while a cancelled one winds down
+    QThreadPool searchPool;
+};
+
+#endif // SEARCHRUNNER_H
@@ -0,0 +1,216 @@
+#include "sidecarindex.h"
+
+#include <algorithm>
+
+QStringList SidecarIndex::tokenize(const QString &text)
+{
+    QStringList tokens;
+    int start = -1;
+    for (int i = 0; i <= text.size(); ++i) {
+        bool wordChar = i < text.size() && text.at(i).isLetterOrNumber();
+        if (wordChar && start < 0) {
+            start = i;
+        } else if (!wordChar && start >= 0) {
+            tokens.append(text.mid(start, i - start).toLower());
+            start = -1;
+        }
+    }
+    return tokens;
+}
+
+void SidecarIndex::add(quint32 id, const QStringList &tokens)
+{
+    remove(id);
+    if (sequences.size() <= int(id))
+        sequences.resize(int(id) + 1);
+
+    QVector<quint32> &sequence = sequences[int(id)];
+    sequence.reserve(tokens.size());
+    for (const QString &token : tokens) {
+        auto found = wordIds.constFind(token);
+        quint32 wordId;
+        if (found != wordIds.constEnd()) {
+            wordId = found.value();
+        } else {
+            wordId = quint32(words.size());
+            wordIds.insert(token, wordId);
+            words.append(token);
+            wordPostings.append(QVector<quint32>());
+            unsortedPostings.append(false);
+        }
+        sequence.append(wordId);
+
+        QVector<quint32> &list = wordPostings[int(wordId)];
+        if (!list.isEmpty() && list.constLast() >= id) {
+            if (list.constLast() == id)
+                continue;  // the word repeats within this sidecar
+            unsortedPostings[int(wordId)] = true;
+        }
+        list.append(id);
+    }
+    if (!sequence.isEmpty())
+        ++liveRecords;
+}
+
+void SidecarIndex::remove(quint32 id)
+{
+    if (int(id) >= sequences.size() || sequences.at(int(id)).isEmpty())
+        return;
+
+    sequences[int(id)] = QVector<quint32>();
+    --liveRecords;
+    if (++staleRecords > qMax(1024, liveRecords))
+        rebuildPostings();
+}
+
+void SidecarIndex::clear()
+{
+    wordIds.clear();
+    words.clear();
+    wordPostings.clear();
+    unsortedPostings.clear();
+    sequences.clear();
+    liveRecords = 0;
+    staleRecords = 0;
+}
+
+QVector<quint32> SidecarIndex::search(const Query &query) const
+{
+    const Phrase &phrase = query.phrase;
+    if (phrase.isEmpty())
+        return QVector<quint32>();
+
+    // Candidates come from the query word with the fewest records
+    int rarest = 0;
+    qint64 rarestCount = -1;
+    for (int i = 0; i < phrase.size(); ++i) {
+        qint64 count = 0;
+        for (quint32 wordId : phrase.at(i))
+            count += wordPostings.at(int(wordId)).size();
+        if (rarestCount < 0 || count < rarestCount) {
+            rarest = i;
+            rarestCount = count;
+        }
+    }
+
+    QVector<quint32> candidates;
+    for (quint32 wordId : phrase.at(rarest))
+        candidates += postings(wordId);
+    if (phrase.at(rarest).size() > 1) {
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+
+    QVector<quint32> result;
+    for (quint32 id : candidates) {
+        if (containsPhrase(id, phrase))
+            result.append(id);
+    }
+    return result;
+}
+
+bool SidecarIndex::matches(quint32 id, const Query &query) const
+{
+    return !query.phrase.isEmpty() && containsPhrase(id, query.phrase);
+}
+
+qint64 SidecarIndex::memoryBytes() const
+{
+    qint64 bytes = 0;
+    for (const QString &word : words)
+        bytes += qint64(word.capacity()) * 2 + qint64(sizeof(QString) + sizeof(quint32));
+    const QVector<QVector<quint32>> &constPostings = wordPostings;
+    for (const QVector<quint32> &list : constPostings)
+        bytes += qint64(list.capacity()) * qint64(sizeof(quint32)) + qint64(sizeof(list));
+    for (const QVector<quint32> &sequence : sequences)
+        bytes += qint64(sequence.capacity()) * qint64(sizeof(quint32)) + qint64(sizeof(sequence));
+    return bytes;
+}
+
+SidecarIndex::Query SidecarIndex::parse(const QString &text) const
+{
+    Query query;
+    const QStringList tokens = tokenize(text);
+    if (tokens.isEmpty())
+        return query;
+
+    // A query that ends in a word is still being typed; one that ends in a
+    // quote or a space has its last word complete
+    bool prefixLast = text.at(text.size() - 1).isLetterOrNumber();
+
+    Phrase phrase;
+    for (int i = 0; i < tokens.size(); ++i) {
+        QVector<quint32> alternatives;
+        if (prefixLast && i == tokens.size() - 1) {
+            // Ascending, as word ids are handed out in order
+            for (int wordId = 0; wordId < words.size(); ++wordId) {
+                if (words.at(wordId).startsWith(tokens.at(i)))
+                    alternatives.append(quint32(wordId));
+            }
+        } else {
+            auto found = wordIds.constFind(tokens.at(i));
+            if (found != wordIds.constEnd())
+                alternatives.append(found.value());
+        }
+        if (alternatives.isEmpty())
+            return query;
+        phrase.append(alternatives);
+    }
+    query.phrase = phrase;
+    return query;
+}
+
+bool SidecarIndex::containsPhrase(quint32 id, const Phrase &phrase) const
+{
+    if (int(id) >= sequences.size())
+        return false;
+
+    const QVector<quint32> &sequence = sequences.at(int(id));
+    for (int start = 0; start + phrase.size() <= sequence.size(); ++start) {
+        int i = 0;
+        while (i < phrase.size()
+               && std::binary_search(phrase.at(i).constBegin(), phrase.at(i).constEnd(), sequence.at(start + i)))
+            ++i;
+        if (i == phrase.size())
+            return true;
+    }
+    return false;
+}
+
+QVector<quint32> SidecarIndex::postings(quint32 wordId) const
+{
+    QVector<quint32> list = wordPostings.at(int(wordId));
+    if (unsortedPostings.at(int(wordId))) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    return list;
+}
+
+void SidecarIndex::sortPending() const
+{
+    for (int wordId = 0; wordId < unsortedPostings.size(); ++wordId) {
+        if (!unsortedPostings.at(wordId))
+            continue;
+        QVector<quint32> &list = wordPostings[wordId];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        unsortedPostings[wordId] = false;
+    }
+}
+
+// Posting lists rebuilt from the sequences, without the removed records
+void SidecarIndex::rebuildPostings()
+{
+    for (QVector<quint32> &list : wordPostings)
+        list.clear();
+    for (int id = 0; id < sequences.size(); ++id) {
+        for (quint32 wordId : sequences.at(id)) {
+            QVector<quint32> &list = wordPostings[int(wordId)];
+            if (list.isEmpty() || list.constLast() != quint32(id))
+                list.append(quint32(id));
+        }
+    }
+    unsortedPostings.fill(false);
+    staleRecords = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef SIDECARINDEX_H
+#define SIDECARINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Inverted index over the words of the sidecar .txt files.
+// Every record keeps its sidecar as a sequence of word ids, and every word a
+// posting list of the records using it. A query matches a record when its
+// words appear there in the same order, so 'Defect type "A"' finds the line
+// it was typed from and "porosity" finds any mention. The last query word is
+// matched as a prefix while it is still being typed. Lookups never modify the
+// index, so copies of it can be searched from other threads.
+class SidecarIndex
+{
+public:
+    // Lower-cased runs of letters and digits
+    static QStringList tokenize(const QString &text);
+
+    void add(quint32 id, const QStringList &tokens);
+    void remove(quint32 id);
+    void clear();
+
+    // The query words resolved to word ids. Built once per search, since a
+    // prefix last word is looked up against the whole vocabulary; only valid
+    // for the index that built it, until that index changes.
+    class Query
+    {
+    public:
+        // True when some query word appears in no sidecar, so nothing matches
+        bool isEmpty() const { return phrase.isEmpty(); }
+
+    private:
+        friend class SidecarIndex;
+        // For each query word, the sorted word ids it may stand for
+        QVector<QVector<quint32>> phrase;
+    };
+    Query parse(const QString &text) const;
+
+    // Sorted ids whose sidecar contains the query
+    QVector<quint32> search(const Query &query) const;
+    bool matches(quint32 id, const Query &query) const;
+    // Sorts the posting lists that got ids out of order
+    void sortPending() const;
+
+    qint64 memoryBytes() const;
+
+private:
+    using Phrase = QVector<QVector<quint32>>;
+
+    bool containsPhrase(quint32 id, const Phrase &phrase) const;
+    QVector<quint32> postings(quint32 wordId) const;
+    void rebuildPostings();
+
+    QHash<QString, quint32> wordIds;
+    QStringList words;
+    // Posting lists, indexed by word id; a list that got an id out of order is
+    // sorted by sortPending(). Removed records stay until rebuildPostings().
+    mutable QVector<QVector<quint32>> wordPostings;
+    mutable QVector<bool> unsortedPostings;
+    QVector<QVector<quint32>> sequences;  // indexed by record id
+    int liveRecords = 0;
+    int staleRecords = 0;
+};
+
+#endif // SIDECARINDEX_H
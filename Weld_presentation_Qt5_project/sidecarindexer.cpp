@@ -0,0 +1,49 @@
+#include "sidecarindexer.h"
+
+#include <QFile>
+
+#include "sidecarindex.h"
+#include "weldrecord.h"
+
+namespace {
+const int kBatchSize = 256;
+}
+
+SidecarIndexer::SidecarIndexer(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<SidecarText>("SidecarText");
+    qRegisterMetaType<QVector<SidecarText>>("QVector<SidecarText>");
+}
+
+void SidecarIndexer::requestSidecars(const QString &folderPath, const QStringList &fileNames)
+{
+    if (fileNames.isEmpty())
+        return;
+    QMetaObject::invokeMethod(this, [this, folderPath, fileNames]() {
+        readSidecars(folderPath, fileNames);
+    }, Qt::QueuedConnection);
+}
+
+void SidecarIndexer::readSidecars(const QString &folderPath, const QStringList &fileNames)
+{
+    QVector<SidecarText> batch;
+    batch.reserve(kBatchSize);
+    for (const QString &fileName : fileNames) {
+        if (stopped)
+            return;
+
+        // A sidecar that has not arrived yet is read when its record is updated
+        QFile file(sidecarPathFor(folderPath + "/" + fileName));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            continue;
+        batch.append({fileName, SidecarIndex::tokenize(QString::fromUtf8(file.readAll()))});
+
+        if (batch.size() == kBatchSize) {
+            emit sidecarsRead(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.isEmpty())
+        emit sidecarsRead(batch);
+}
@@ -0,0 +1,42 @@
+#ifndef SIDECARINDEXER_H
+#define SIDECARINDEXER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+// Words of one sidecar, keyed by the image's path relative to the data root
+struct SidecarText
+{
+    QString fileName;
+    QStringList words;
+};
+
+// Reads and tokenizes sidecar .txt files on the thread it lives on, so the
+// search index can be filled without blocking the GUI.
+class SidecarIndexer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SidecarIndexer(QObject *parent = nullptr);
+
+    // Thread safe. fileNames are image paths relative to folderPath.
+    void requestSidecars(const QString &folderPath, const QStringList &fileNames);
+    void stop() { stopped = true; }
+
+signals:
+    void sidecarsRead(const QVector<SidecarText> &sidecars);
+
+private:
+    void readSidecars(const QString &folderPath, const QStringList &fileNames);
+
+    std::atomic<bool> stopped{false};
+};
+
+Q_DECLARE_METATYPE(SidecarText)
+
+#endif // SIDECARINDEXER_H
@@ -0,0 +1,77 @@
+#include "startupprofiler.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include "appsettings.h"
+
+namespace {
+struct PhaseInfo
+{
+    const char *name;
+    const char *settingKey;
+    int defaultBudgetMs;
+};
+
+const PhaseInfo kPhases[StartupProfiler::PhaseCount] = {
+    {"QApplication", "startup/qapplicationMs", 300},
+    {"setupUi", "startup/setupUiMs", 200},
+    {"first paint", "startup/firstPaintMs", 1000},
+    {"catalog", "startup/catalogMs", 300},
+    {"scan", "startup/scanMs", 5000},
+    {"first sync", "startup/firstSyncMs", 30000},
+};
+
+QElapsedTimer &clock()
+{
+    static QElapsedTimer timer;
+    if (!timer.isValid())
+        timer.start();
+    return timer;
+}
+
+qint64 beginMs[StartupProfiler::PhaseCount] = {-1, -1, -1, -1, -1, -1};
+qint64 elapsedMs[StartupProfiler::PhaseCount] = {-1, -1, -1, -1, -1, -1};
+}
+
+void StartupProfiler::begin(Phase phase)
+{
+    if (beginMs[phase] < 0)
+        beginMs[phase] = clock().elapsed();
+}
+
+void StartupProfiler::end(Phase phase)
+{
+    if (beginMs[phase] < 0 || elapsedMs[phase] >= 0)
+        return;
+    elapsedMs[phase] = clock().elapsed() - beginMs[phase];
+
+    const PhaseInfo &info = kPhases[phase];
+    int budget = appSettings().value(info.settingKey, info.defaultBudgetMs).toInt();
+    if (elapsedMs[phase] > budget)
+        qWarning() << "Startup phase" << info.name << "took" << elapsedMs[phase] << "ms, over its" << budget << "ms budget";
+    else
+        qDebug() << "Startup phase" << info.name << "took" << elapsedMs[phase] << "ms (budget" << budget << "ms)";
+
+    for (qint64 ms : elapsedMs) {
+        if (ms < 0)
+            return;
+    }
+    reportSummary();
+}
+
+qint64 StartupProfiler::elapsed(Phase phase)
+{
+    return elapsedMs[phase];
+}
+
+void StartupProfiler::reportSummary()
+{
+    qDebug() << "Startup summary:";
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        const PhaseInfo &info = kPhases[phase];
+        int budget = appSettings().value(info.settingKey, info.defaultBudgetMs).toInt();
+        qDebug().nospace() << "  " << info.name << ": " << elapsedMs[phase] << " ms / " << budget << " ms"
+                           << (elapsedMs[phase] > budget ? "  OVER" : "");
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QtGlobal>
+
+// Times the startup phases and reports each against its budget from
+// weld_station.ini ([startup] <phase>Ms). A phase is only timed once; later
+// begin()/end() calls for it are ignored, so call sites need no first-time flags.
+class StartupProfiler
+{
+public:
+    enum Phase {
+        QApplicationPhase,
+        SetupUiPhase,
+        FirstPaintPhase,   // from the start of main()
+        CatalogPhase,
+        ScanPhase,
+        FirstSyncPhase,
+        PhaseCount
+    };
+
+    static void begin(Phase phase);
+    static void end(Phase phase);
+    static qint64 elapsed(Phase phase);
+
+private:
+    static void reportSummary();
+};
+
+#endif // STARTUPPROFILER_H
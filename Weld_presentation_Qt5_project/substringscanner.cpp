@@ -0,0 +1,184 @@
+#include "substringscanner.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WELD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if WELD_HAVE_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define WELD_HAVE_AVX2 1
+#include <immintrin.h>
+#define WELD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+inline char foldAscii(char c)
+{
+    return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c;
+}
+
+inline int lowestBit(unsigned mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+#if WELD_HAVE_SSE2
+// 'A'..'Z' become 'a'..'z': bytes whose offset from 'A' is below 26 get 0x20 set
+inline __m128i foldBlock(__m128i block)
+{
+    const __m128i offset = _mm_sub_epi8(block, _mm_set1_epi8('A'));
+    const __m128i upper = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(25)), offset);
+    return _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+#if WELD_HAVE_AVX2
+WELD_TARGET_AVX2 inline __m256i foldBlock(__m256i block)
+{
+    const __m256i offset = _mm256_sub_epi8(block, _mm256_set1_epi8('A'));
+    const __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(25)), offset);
+    return _mm256_or_si256(block, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+enum class Kernel { Scalar, Sse2, Avx2 };
+
+Kernel detectKernel()
+{
+#if WELD_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return Kernel::Avx2;
+#endif
+#if WELD_HAVE_SSE2
+    return Kernel::Sse2;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+const Kernel kKernel = detectKernel();
+
+}  // namespace
+
+SubstringScanner::SubstringScanner(const QByteArray &needle)
+    : foldedNeedle(needle)
+{
+    for (int i = 0; i < foldedNeedle.size(); ++i)
+        foldedNeedle[i] = foldAscii(foldedNeedle.at(i));
+}
+
+int SubstringScanner::indexIn(const char *data, int size, int from) const
+{
+    if (foldedNeedle.isEmpty())
+        return from <= size ? from : -1;
+    if (from < 0 || size - from < foldedNeedle.size())
+        return -1;
+
+    switch (kKernel) {
+    case Kernel::Avx2:
+        return avx2IndexIn(data, size, from);
+    case Kernel::Sse2:
+        return sse2IndexIn(data, size, from);
+    default:
+        return scalarIndexIn(data, size, from);
+    }
+}
+
+const char *SubstringScanner::implementation()
+{
+    switch (kKernel) {
+    case Kernel::Avx2:
+        return "AVX2";
+    case Kernel::Sse2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+bool SubstringScanner::matchesAt(const char *data) const
+{
+    const char *needle = foldedNeedle.constData();
+    for (int i = 0; i < foldedNeedle.size(); ++i) {
+        if (foldAscii(data[i]) != needle[i])
+            return false;
+    }
+    return true;
+}
+
+int SubstringScanner::scalarIndexIn(const char *data, int size, int from) const
+{
+    const char first = foldedNeedle.at(0);
+    const int last = size - foldedNeedle.size();
+    for (int i = from; i <= last; ++i) {
+        if (foldAscii(data[i]) == first && matchesAt(data + i))
+            return i;
+    }
+    return -1;
+}
+
+int SubstringScanner::sse2IndexIn(const char *data, int size, int from) const
+{
+#if WELD_HAVE_SSE2
+    const int length = foldedNeedle.size();
+    const __m128i first = _mm_set1_epi8(foldedNeedle.at(0));
+    const __m128i last = _mm_set1_epi8(foldedNeedle.at(length - 1));
+
+    int i = from;
+    // Both loads (at i and at i + length - 1) must stay inside the buffer
+    for (; i + length - 1 + 16 <= size; i += 16) {
+        const __m128i blockFirst = foldBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+        const __m128i blockLast = foldBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + length - 1)));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                                 _mm_cmpeq_epi8(blockLast, last))));
+        while (mask) {
+            int offset = i + lowestBit(mask);
+            if (matchesAt(data + offset))
+                return offset;
+            mask &= mask - 1;
+        }
+    }
+    return scalarIndexIn(data, size, i);
+#else
+    return scalarIndexIn(data, size, from);
+#endif
+}
+
+#if WELD_HAVE_AVX2
+WELD_TARGET_AVX2
+#endif
+int SubstringScanner::avx2IndexIn(const char *data, int size, int from) const
+{
+#if WELD_HAVE_AVX2
+    const int length = foldedNeedle.size();
+    const __m256i first = _mm256_set1_epi8(foldedNeedle.at(0));
+    const __m256i last = _mm256_set1_epi8(foldedNeedle.at(length - 1));
+
+    int i = from;
+    for (; i + length - 1 + 32 <= size; i += 32) {
+        const __m256i blockFirst = foldBlock(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i)));
+        const __m256i blockLast = foldBlock(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + length - 1)));
+        unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                                       _mm256_cmpeq_epi8(blockLast, last))));
+        while (mask) {
+            int offset = i + lowestBit(mask);
+            if (matchesAt(data + offset))
+                return offset;
+            mask &= mask - 1;
+        }
+    }
+    return sse2IndexIn(data, size, i);
+#else
+    return sse2IndexIn(data, size, from);
+#endif
+}
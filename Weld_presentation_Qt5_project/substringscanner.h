@@ -0,0 +1,31 @@
+#ifndef SUBSTRINGSCANNER_H
+#define SUBSTRINGSCANNER_H
+
+#include <QByteArray>
+
+// Case-insensitive (ASCII) substring search over a byte buffer, 16 or 32
+// bytes at a time. Blocks are compared against the first and last byte of
+// the needle, and only positions where both match are checked in full.
+// AVX2 is used when the CPU has it, SSE2 on any other x86-64, and a plain
+// loop elsewhere. Bytes outside ASCII are compared as they are.
+class SubstringScanner
+{
+public:
+    explicit SubstringScanner(const QByteArray &needle);
+
+    // Offset of the first match at or after from, or -1
+    int indexIn(const char *data, int size, int from = 0) const;
+    int indexIn(const QByteArray &data, int from = 0) const { return indexIn(data.constData(), data.size(), from); }
+
+    static const char *implementation();
+
+private:
+    bool matchesAt(const char *data) const;
+    int scalarIndexIn(const char *data, int size, int from) const;
+    int sse2IndexIn(const char *data, int size, int from) const;
+    int avx2IndexIn(const char *data, int size, int from) const;
+
+    QByteArray foldedNeedle;
+};
+
+#endif // SUBSTRINGSCANNER_H
@@ -0,0 +1,234 @@
+#include "thumbnailloader.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QVector>
+
+#include <algorithm>
+
+#include "pooltask.h"
+
+namespace {
+
+// Enough pixmaps for several screens of rows
+const int kCachedPixmaps = 2048;
+// Images that could not be read; past this many the list is started afresh
+const int kMaxFailedKeys = 4096;
+// A trim takes the disk cache down to this share of its limit, so it is not
+// trimmed again by the next few thumbnails
+const double kTrimTarget = 0.9;
+
+QString keyOf(const QString &fileName, qint64 mtimeMs)
+{
+    return fileName + '|' + QString::number(mtimeMs);
+}
+
+QString sha1Hex(const QByteArray &data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+// Two-character subdirectories keep any one directory small
+QString shardedPath(const QString &directory, const QString &hash, const QString &suffix)
+{
+    return directory + "/" + hash.left(2) + "/" + hash + suffix;
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+
+}  // namespace
+
+ThumbnailLoader::ThumbnailLoader(const QString &dataRoot, const QString &cacheDirectory, QObject *parent)
+    : QObject(parent)
+    , dataRoot(dataRoot)
+    , cacheDirectory(cacheDirectory)
+    , pixmaps(kCachedPixmaps)
+{
+    // Thumbnails are a nicety; leave most cores to searches and the clicked image
+    thumbnailPool.setMaxThreadCount(2);
+    connect(this, &ThumbnailLoader::thumbnailMade, this, &ThumbnailLoader::storeThumbnail, Qt::QueuedConnection);
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    {
+        QMutexLocker locker(&mutex);
+        pending.clear();
+    }
+    thumbnailPool.waitForDone();
+}
+
+QPixmap ThumbnailLoader::thumbnail(quint32 id, const QString &fileName, qint64 mtimeMs)
+{
+    const QString key = keyOf(fileName, mtimeMs);
+    if (QPixmap *pixmap = pixmaps.object(key))
+        return *pixmap;
+    if (failedKeys.contains(key))
+        return QPixmap();
+
+    QMutexLocker locker(&mutex);
+    if (queuedKeys.contains(key)) {
+        // Asked for again, so it is on screen: move it to the front of the queue
+        for (int i = 0; i < pending.size(); ++i) {
+            if (pending.at(i).key == key) {
+                pending.append(pending.takeAt(i));
+                break;
+            }
+        }
+        return QPixmap();
+    }
+
+    pending.append(Request{id, fileName, mtimeMs, key});
+    queuedKeys.insert(key);
+    if (pending.size() > kMaxPending)
+        queuedKeys.remove(pending.takeFirst().key);
+    locker.unlock();
+
+    startInPool(thumbnailPool, [this]() { makeNext(); });
+    return QPixmap();
+}
+
+QPixmap ThumbnailLoader::placeholder()
+{
+    if (blank.isNull()) {
+        blank = QPixmap(kWidth, kHeight);
+        blank.fill(Qt::transparent);
+    }
+    return blank;
+}
+
+// Runs on a thumbnail thread; one task is started per request, and a task
+// whose request was dropped finds the queue empty
+void ThumbnailLoader::makeNext()
+{
+    Request request;
+    {
+        QMutexLocker locker(&mutex);
+        if (pending.isEmpty())
+            return;
+        request = pending.takeLast();
+    }
+
+    QImage image = makeThumbnail(dataRoot + "/" + request.fileName, request.fileName, request.mtimeMs);
+    {
+        QMutexLocker locker(&mutex);
+        queuedKeys.remove(request.key);
+    }
+    emit thumbnailMade(request.id, request.key, image);
+}
+
+// Hex SHA-1 of the whole file, or an empty string if it cannot be read.
+// Worked out once per version of a file: the result is kept under names/,
+// keyed by the file's name, size and mtime.
+QString ThumbnailLoader::contentHash(const QString &path, const QString &fileName, qint64 mtimeMs)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+    const QString nameKey = sha1Hex(keyOf(fileName, mtimeMs).toUtf8() + '|' + QByteArray::number(file.size()));
+    const QString namePath = shardedPath(cacheDirectory + "/names", nameKey, QString());
+
+    QFile known(namePath);
+    if (known.open(QIODevice::ReadOnly)) {
+        QString hash = QString::fromLatin1(known.read(64)).trimmed();
+        if (hash.size() == 40)
+            return hash;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file) || file.error() != QFile::NoError)
+        return QString();
+    const QByteArray hex = hash.result().toHex();
+    writeFile(namePath, hex);
+    return QString::fromLatin1(hex);
+}
+
+// The cached thumbnail if there is one, else a reduced decode of the image
+// saved for next time. A null image if the image cannot be read.
+QImage ThumbnailLoader::makeThumbnail(const QString &path, const QString &fileName, qint64 mtimeMs)
+{
+    const QString hash = contentHash(path, fileName, mtimeMs);
+    if (hash.isEmpty())
+        return QImage();
+
+    const QString cachePath = shardedPath(cacheDirectory, hash, ".jpg");
+    QImage image(cachePath);
+    if (!image.isNull())
+        return image;
+
+    // JPEG decoders can skip most of the work when asked for a smaller image
+    QImageReader reader(path);
+    QSize size = reader.size();
+    if (size.isValid())
+        reader.setScaledSize(size.scaled(2 * kWidth, 2 * kHeight, Qt::KeepAspectRatio));
+    image = reader.read();
+    if (image.isNull())
+        return QImage();
+    image = image.scaled(kWidth, kHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    QSaveFile saved(cachePath);
+    if (!saved.open(QIODevice::WriteOnly) || !image.save(&saved, "JPG", 85) || !saved.commit())
+        qWarning() << "Could not save thumbnail" << cachePath;
+    return image;
+}
+
+void ThumbnailLoader::storeThumbnail(quint32 id, const QString &key, const QImage &image)
+{
+    if (image.isNull()) {
+        if (failedKeys.size() >= kMaxFailedKeys)
+            failedKeys.clear();
+        failedKeys.insert(key);
+        return;
+    }
+    pixmaps.insert(key, new QPixmap(QPixmap::fromImage(image)));
+    emit thumbnailReady(id);
+}
+
+void ThumbnailLoader::trimDiskCache(qint64 maxBytes)
+{
+    startInPool(thumbnailPool, [this, maxBytes]() {
+        struct Entry
+        {
+            QString path;
+            qint64 size;
+            QDateTime modified;
+        };
+        QVector<Entry> entries;
+        qint64 total = 0;
+        QDirIterator it(cacheDirectory, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo info = it.fileInfo();
+            entries.append(Entry{info.filePath(), info.size(), info.lastModified()});
+            total += info.size();
+        }
+        if (total <= maxBytes)
+            return;
+
+        // Oldest first; a thumbnail removed here is simply made again when its row shows
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.modified < b.modified;
+        });
+        const qint64 target = qint64(maxBytes * kTrimTarget);
+        for (const Entry &entry : entries) {
+            if (total <= target)
+                break;
+            if (QFile::remove(entry.path))
+                total -= entry.size;
+        }
+    });
+}
@@ -0,0 +1,78 @@
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QSize>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+// Small previews of the weld images for weldImageList's icons.
+// Thumbnails are made in the background and kept on disk under the cache
+// directory, keyed by a SHA-1 of the whole image file, so they survive
+// restarts, follow a renamed file and change with a rewritten one. The hash
+// of each version of a file is kept there too, so the file is read in full
+// once rather than on every lookup. Only rows the view
+// asks for are queued, and the most recently asked for go first; once more
+// than kMaxPending wait, the oldest requests (rows long scrolled past) are
+// dropped before anything was decoded for them.
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kWidth = 64;
+    static constexpr int kHeight = 48;
+
+    ThumbnailLoader(const QString &dataRoot, const QString &cacheDirectory, QObject *parent = nullptr);
+    ~ThumbnailLoader();
+
+    // GUI thread only. The thumbnail if it is ready, else a null pixmap and
+    // the thumbnail is queued; thumbnailReady() follows.
+    QPixmap thumbnail(quint32 id, const QString &fileName, qint64 mtimeMs);
+    // Blank, at the full thumbnail size, for rows whose thumbnail is not there;
+    // with uniform item sizes the view measures one row for all of them
+    QPixmap placeholder();
+    // In the background, deletes the oldest cache files until the cache
+    // directory is back under maxBytes
+    void trimDiskCache(qint64 maxBytes);
+
+signals:
+    void thumbnailReady(quint32 id);
+    void thumbnailMade(quint32 id, const QString &key, const QImage &image);  // internal, queued to the GUI thread
+
+private:
+    struct Request
+    {
+        quint32 id;
+        QString fileName;
+        qint64 mtimeMs;
+        QString key;  // fileName and mtime, for the in-memory cache
+    };
+
+    void makeNext();
+    QString contentHash(const QString &path, const QString &fileName, qint64 mtimeMs);
+    QImage makeThumbnail(const QString &path, const QString &fileName, qint64 mtimeMs);
+    void storeThumbnail(quint32 id, const QString &key, const QImage &image);
+
+    static const int kMaxPending = 64;
+
+    QString dataRoot;
+    QString cacheDirectory;
+    // GUI thread only
+    QCache<QString, QPixmap> pixmaps;
+    QSet<QString> failedKeys;          // not asked for again
+    QPixmap blank;
+
+    QMutex mutex;
+    QVector<Request> pending;          // newest last
+    QSet<QString> queuedKeys;          // pending or being made
+    QThreadPool thumbnailPool;
+};
+
+#endif // THUMBNAILLOADER_H
@@ -0,0 +1,387 @@
+#include "tilepyramid.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+#include <memory>
+
+#ifdef WELD_HAVE_LIBJPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace {
+
+const quint32 kMagic = 0x59505457;  // "WTPY"
+const quint32 kVersion = 1;
+const int kHeaderBytes = 6 * 4;
+const int kEntryBytes = 8 + 4;
+const int kTileQuality = 85;
+// Formats that cannot be streamed are decoded whole; past this many pixels
+// (512 MB as RGB32) they get no pyramid
+const qint64 kMaxWholeDecodePixels = qint64(1) << 27;
+
+int tilesAcross(int length)
+{
+    return (length + TilePyramid::kTileSize - 1) / TilePyramid::kTileSize;
+}
+
+struct TileEntry
+{
+    quint64 offset = 0;
+    quint32 length = 0;
+};
+
+// Writes tiles band by band and hands each band, halved, to the next level
+class PyramidWriter
+{
+public:
+    PyramidWriter(QSaveFile &file, const QVector<QSize> &sizes)
+        : file(file)
+        , sizes(sizes)
+        , entries(sizes.size())
+        , bands(sizes.size())
+        , bandRows(sizes.size(), 0)
+        , bandTops(sizes.size(), 0)
+    {
+        for (int level = 0; level < sizes.size(); ++level) {
+            entries[level].resize(tilesAcross(sizes.at(level).width()) * tilesAcross(sizes.at(level).height()));
+            bands[level] = QImage(sizes.at(level).width(), TilePyramid::kTileSize, QImage::Format_RGB32);
+        }
+    }
+
+    // Rows of a level, top to bottom, in pieces of any height up to a band
+    bool feed(int level, const QImage &rows)
+    {
+        const QImage source = rows.convertToFormat(QImage::Format_RGB32);
+        const int width = sizes.at(level).width();
+        int copied = 0;
+        while (copied < source.height()) {
+            int count = qMin(source.height() - copied, TilePyramid::kTileSize - bandRows[level]);
+            for (int i = 0; i < count; ++i)
+                std::memcpy(bands[level].scanLine(bandRows[level] + i), source.constScanLine(copied + i), size_t(width) * 4);
+            bandRows[level] += count;
+            copied += count;
+
+            bool last = bandTops[level] + bandRows[level] >= sizes.at(level).height();
+            if (bandRows[level] == TilePyramid::kTileSize || last) {
+                if (!writeBand(level))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    const QVector<TileEntry> &tileEntries(int level) const { return entries.at(level); }
+
+private:
+    bool writeBand(int level)
+    {
+        const QImage band = bands[level].copy(0, 0, sizes.at(level).width(), bandRows[level]);
+        const int row = bandTops[level] / TilePyramid::kTileSize;
+        const int columns = tilesAcross(band.width());
+        for (int column = 0; column < columns; ++column) {
+            int x = column * TilePyramid::kTileSize;
+            QByteArray bytes;
+            QBuffer buffer(&bytes);
+            buffer.open(QIODevice::WriteOnly);
+            if (!band.copy(x, 0, qMin(TilePyramid::kTileSize, band.width() - x), band.height())
+                     .save(&buffer, "JPG", kTileQuality))
+                return false;
+
+            TileEntry &entry = entries[level][row * columns + column];
+            entry.offset = quint64(file.pos());
+            entry.length = quint32(bytes.size());
+            if (file.write(bytes) != bytes.size())
+                return false;
+        }
+        bandTops[level] += bandRows[level];
+        bandRows[level] = 0;
+
+        // A 2:1 smooth scale averages within the band, so halving band by band matches halving the whole
+        if (level + 1 < sizes.size())
+            return feed(level + 1, band.scaled((band.width() + 1) / 2, (band.height() + 1) / 2,
+                                               Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+        return true;
+    }
+
+    QSaveFile &file;
+    QVector<QSize> sizes;
+    QVector<QVector<TileEntry>> entries;  // per level, row by row
+    QVector<QImage> bands;
+    QVector<int> bandRows;  // rows filled in each level's band
+    QVector<int> bandTops;  // level row the band starts at
+};
+
+// Hands out the rows of the full-size image top to bottom, each decoded once
+class RowSource
+{
+public:
+    virtual ~RowSource() = default;
+    // The next count rows, fewer at the bottom; null on a read error or past the end
+    virtual QImage read(int count) = 0;
+};
+
+// Any format Qt reads: the whole image is decoded once and handed out in bands
+class WholeImageSource : public RowSource
+{
+public:
+    explicit WholeImageSource(const QString &imagePath)
+    {
+        QImageReader reader(imagePath);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        // Qt 6 refuses images past 256 MB by default; allow up to our own cap
+        reader.setAllocationLimit(int(kMaxWholeDecodePixels * 4 / (1024 * 1024)));
+#endif
+        image = reader.read();
+    }
+
+    QImage read(int count) override
+    {
+        if (image.isNull() || next >= image.height())
+            return QImage();
+        // Shares the decoded pixels, which outlive the band
+        const int rows = qMin(count, image.height() - next);
+        QImage band(image.constScanLine(next), image.width(), rows, image.bytesPerLine(), image.format());
+        band.setColorTable(image.colorTable());
+        next += rows;
+        return band;
+    }
+
+private:
+    QImage image;
+    int next = 0;
+};
+
+#ifdef WELD_HAVE_LIBJPEG
+// libjpeg reports errors through error_exit, which must not return
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr info)
+{
+    std::longjmp(reinterpret_cast<JpegError *>(info->err)->jump, 1);
+}
+
+// Warnings are counted instead, see JpegSource::read()
+void jpegOutputMessage(j_common_ptr)
+{
+}
+
+// JPEG straight from libjpeg, a band of scanlines at a time, so the full
+// image is never held. Only calls into libjpeg lie between a setjmp() and
+// the longjmp() an error makes.
+class JpegSource : public RowSource
+{
+public:
+    ~JpegSource() override
+    {
+        if (created)
+            jpeg_destroy_decompress(&info);
+    }
+
+    // False if libjpeg cannot decode data, or if the data is progressive:
+    // libjpeg then holds every coefficient of the image until the last scan,
+    // so nothing is saved over a whole decode
+    bool start(const uchar *data, qint64 size)
+    {
+        info.err = jpeg_std_error(&error.manager);
+        error.manager.error_exit = jpegErrorExit;
+        error.manager.output_message = jpegOutputMessage;
+        if (setjmp(error.jump))
+            return false;
+        jpeg_create_decompress(&info);
+        created = true;
+        jpeg_mem_src(&info, const_cast<uchar *>(data), static_cast<unsigned long>(size));
+        jpeg_read_header(&info, TRUE);
+        if (jpeg_has_multiple_scans(&info))
+            return false;
+#ifdef JCS_EXTENSIONS
+        // Decoded straight into QImage's 32-bit layout
+        info.out_color_space = Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? JCS_EXT_BGRX : JCS_EXT_XRGB;
+        format = QImage::Format_RGB32;
+#else
+        info.out_color_space = JCS_RGB;
+        format = QImage::Format_RGB888;
+#endif
+        jpeg_start_decompress(&info);
+        return true;
+    }
+
+    QSize size() const { return QSize(int(info.output_width), int(info.output_height)); }
+
+    QImage read(int count) override
+    {
+        const int first = int(info.output_scanline);
+        const int rows = qMin(count, int(info.output_height) - first);
+        if (rows <= 0)
+            return QImage();
+        QImage band(int(info.output_width), rows, format);
+        if (band.isNull())
+            return QImage();
+
+        if (setjmp(error.jump))
+            return QImage();
+        while (int(info.output_scanline) < first + rows) {
+            JSAMPROW row = band.scanLine(int(info.output_scanline) - first);
+            jpeg_read_scanlines(&info, &row, 1);
+        }
+        // Corrupt or cut-short data decodes as grey; a file still being written gets its pyramid later
+        if (error.manager.num_warnings > 0)
+            return QImage();
+        return band;
+    }
+
+private:
+    jpeg_decompress_struct info;
+    JpegError error;
+    bool created = false;
+    QImage::Format format = QImage::Format_RGB32;
+};
+#endif
+
+}  // namespace
+
+TilePyramid::~TilePyramid()
+{
+    close();
+}
+
+bool TilePyramid::build(const QString &imagePath, const QString &pyramidPath, const std::function<bool()> &cancelled)
+{
+    const QSize fullSize = QImageReader(imagePath).size();
+    if (!fullSize.isValid())
+        return false;
+
+    QVector<QSize> sizes{fullSize};
+    while (sizes.last().width() > kTileSize || sizes.last().height() > kTileSize)
+        sizes.append(QSize((sizes.last().width() + 1) / 2, (sizes.last().height() + 1) / 2));
+
+    QSaveFile file(pyramidPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << kMagic << kVersion << quint32(fullSize.width()) << quint32(fullSize.height())
+        << quint32(kTileSize) << quint32(sizes.size());
+
+    // One pass of the decoder over the image. A fresh decode per band, clipped,
+    // would redo the rows above it each time, or the whole image for formats
+    // that cannot clip.
+    QFile imageFile(imagePath);
+    std::unique_ptr<RowSource> source;
+#ifdef WELD_HAVE_LIBJPEG
+    if (imageFile.open(QIODevice::ReadOnly)) {
+        const uchar *bytes = imageFile.map(0, imageFile.size());
+        std::unique_ptr<JpegSource> jpeg(new JpegSource);
+        if (bytes && jpeg->start(bytes, imageFile.size()) && jpeg->size() == fullSize)
+            source = std::move(jpeg);
+    }
+#endif
+    if (!source) {
+        if (qint64(fullSize.width()) * fullSize.height() > kMaxWholeDecodePixels)
+            return false;
+        source.reset(new WholeImageSource(imagePath));
+    }
+
+    PyramidWriter writer(file, sizes);
+    for (int top = 0; top < fullSize.height(); top += kTileSize) {
+        if (cancelled && cancelled())
+            return false;
+        const int rows = qMin(kTileSize, fullSize.height() - top);
+        QImage band = source->read(rows);
+        if (band.width() != fullSize.width() || band.height() != rows || !writer.feed(0, band))
+            return false;
+    }
+
+    const quint64 indexOffset = quint64(file.pos());
+    for (int level = 0; level < sizes.size(); ++level) {
+        out << quint32(sizes.at(level).width()) << quint32(sizes.at(level).height());
+        for (const TileEntry &entry : writer.tileEntries(level))
+            out << entry.offset << entry.length;
+    }
+    out << indexOffset;
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool TilePyramid::open(const QString &path)
+{
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    dataSize = file.size();
+    data = dataSize >= kHeaderBytes + 8 ? file.map(0, dataSize) : nullptr;
+    if (!data) {
+        close();
+        return false;
+    }
+
+    auto word = [this](int i) { return qFromLittleEndian<quint32>(data + 4 * i); };
+    const quint64 indexOffset = qFromLittleEndian<quint64>(data + dataSize - 8);
+    if (word(0) != kMagic || word(1) != kVersion || word(4) != quint32(kTileSize) || indexOffset > quint64(dataSize - 8)) {
+        close();
+        return false;
+    }
+
+    // Index entries point into the map; every tile must lie before the index
+    const uchar *next = data + indexOffset;
+    const uchar *end = data + dataSize - 8;
+    for (quint32 level = 0; level < word(5); ++level) {
+        if (end - next < 8) {
+            close();
+            return false;
+        }
+        Level entry;
+        entry.size = QSize(int(qFromLittleEndian<quint32>(next)), int(qFromLittleEndian<quint32>(next + 4)));
+        entry.columns = tilesAcross(entry.size.width());
+        entry.rows = tilesAcross(entry.size.height());
+        entry.entries = next + 8;
+        next = entry.entries + qint64(entry.columns) * entry.rows * kEntryBytes;
+        if (next > end) {
+            close();
+            return false;
+        }
+        for (int i = 0; i < entry.columns * entry.rows; ++i) {
+            const uchar *tile = entry.entries + i * kEntryBytes;
+            if (qFromLittleEndian<quint64>(tile) + qFromLittleEndian<quint32>(tile + 8) > indexOffset) {
+                close();
+                return false;
+            }
+        }
+        levels.append(entry);
+    }
+    return !levels.isEmpty();
+}
+
+void TilePyramid::close()
+{
+    if (data)
+        file.unmap(const_cast<uchar *>(data));
+    data = nullptr;
+    dataSize = 0;
+    levels.clear();
+    file.close();
+}
+
+QImage TilePyramid::tile(int level, int column, int row) const
+{
+    if (level < 0 || level >= levels.size())
+        return QImage();
+    const Level &entry = levels.at(level);
+    if (column < 0 || row < 0 || column >= entry.columns || row >= entry.rows)
+        return QImage();
+
+    const uchar *tile = entry.entries + (row * entry.columns + column) * kEntryBytes;
+    const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data + qFromLittleEndian<quint64>(tile)),
+                                                     int(qFromLittleEndian<quint32>(tile + 8)));
+    return QImage::fromData(bytes, "JPG");
+}
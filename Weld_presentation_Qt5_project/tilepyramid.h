@@ -0,0 +1,65 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+// Tiles of one very large weld image at every power-of-two reduction, kept
+// in a single file:
+//   header   magic, version, full width and height, tile size, level count
+//   tiles    JPEG-encoded, in the order they were made
+//   index    per level: its width and height, then offset and length of each tile, row by row
+//   trailer  offset of the index
+// Level 0 is full size, each level is half the one before, and the last
+// fits in one tile. A pyramid is read through a memory map, so drawing part
+// of the image touches only the tiles drawn.
+class TilePyramid
+{
+public:
+    static const int kTileSize = 256;
+
+    TilePyramid() = default;
+    TilePyramid(const TilePyramid &) = delete;
+    TilePyramid &operator=(const TilePyramid &) = delete;
+    ~TilePyramid();
+
+    // Decodes imagePath once, top to bottom, each band of tile rows feeding
+    // the levels below it. Baseline JPEG streams through libjpeg when the
+    // build has it, so memory stays at about two bands whatever the image
+    // height; progressive JPEG and other formats are decoded whole, and
+    // refused past 2^27 pixels. False if the
+    // image cannot be read, the file cannot be written or cancelled() returns true.
+    static bool build(const QString &imagePath, const QString &pyramidPath,
+                      const std::function<bool()> &cancelled = std::function<bool()>());
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    QSize size() const { return levelSize(0); }
+    int levelCount() const { return levels.size(); }
+    QSize levelSize(int level) const { return level < levels.size() ? levels.at(level).size : QSize(); }
+    // Decoded from the map; null outside the level
+    QImage tile(int level, int column, int row) const;
+
+private:
+    struct Level
+    {
+        QSize size;
+        int columns;
+        int rows;
+        const uchar *entries;  // offset and length of each tile
+    };
+
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 dataSize = 0;
+    QVector<Level> levels;
+};
+
+#endif // TILEPYRAMID_H
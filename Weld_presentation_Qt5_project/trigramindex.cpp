@@ -0,0 +1,89 @@
+#include "trigramindex.h"
+
+#include <algorithm>
+
+void TrigramIndex::add(quint32 id, const QByteArray &foldedName)
+{
+    const char *name = foldedName.constData();
+    for (int i = 0; i + kMinQueryLength <= foldedName.size(); ++i) {
+        quint32 trigram = key(name + i);
+        QVector<quint32> &list = lists[trigram];
+        if (!list.isEmpty() && list.constLast() >= id) {
+            if (list.constLast() == id)
+                continue;  // the trigram repeats within this name
+            unsortedLists.insert(trigram);
+        }
+        list.append(id);
+    }
+}
+
+void TrigramIndex::clear()
+{
+    lists.clear();
+    unsortedLists.clear();
+}
+
+QVector<quint32> TrigramIndex::candidates(const QByteArray &needle) const
+{
+    QVector<quint32> trigrams;
+    for (int i = 0; i + kMinQueryLength <= needle.size(); ++i) {
+        quint32 trigram = key(needle.constData() + i);
+        if (!trigrams.contains(trigram))
+            trigrams.append(trigram);
+    }
+
+    // Rarest trigram first, so the candidate list starts as short as it can
+    QVector<QVector<quint32>> required;
+    for (quint32 trigram : trigrams) {
+        QVector<quint32> list = postings(trigram);
+        if (list.isEmpty())
+            return QVector<quint32>();
+        required.append(list);
+    }
+    std::sort(required.begin(), required.end(), [](const QVector<quint32> &a, const QVector<quint32> &b) {
+        return a.size() < b.size();
+    });
+
+    QVector<quint32> result = required.constFirst();
+    for (int i = 1; i < required.size() && !result.isEmpty(); ++i) {
+        const QVector<quint32> &list = required.at(i);
+        auto kept = std::remove_if(result.begin(), result.end(), [&list](quint32 id) {
+            return !std::binary_search(list.constBegin(), list.constEnd(), id);
+        });
+        result.erase(kept, result.end());
+    }
+    return result;
+}
+
+void TrigramIndex::sortPending() const
+{
+    for (quint32 trigram : unsortedLists) {
+        QVector<quint32> &list = lists[trigram];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    unsortedLists.clear();
+}
+
+qint64 TrigramIndex::memoryBytes() const
+{
+    const QHash<quint32, QVector<quint32>> &constLists = lists;
+    qint64 bytes = qint64(constLists.capacity()) * qint64(sizeof(quint32) + sizeof(QVector<quint32>));
+    for (const QVector<quint32> &list : constLists)
+        bytes += qint64(list.capacity()) * qint64(sizeof(quint32));
+    return bytes;
+}
+
+QVector<quint32> TrigramIndex::postings(quint32 trigram) const
+{
+    auto found = lists.constFind(trigram);
+    if (found == lists.constEnd())
+        return QVector<quint32>();
+    if (!unsortedLists.contains(trigram))
+        return found.value();
+
+    QVector<quint32> list = found.value();
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    return list;
+}
@@ -0,0 +1,43 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+// Posting lists of record ids for every three-byte sequence of the folded
+// file names. A substring query only has to look at the records holding all
+// of its trigrams, so serial fragments such as "1111" no longer cost a pass
+// over every name. Candidates still need checking against the name itself.
+// Removal is lazy: stale ids stay in the lists until the owner rebuilds.
+// Lookups never modify the index, so copies of it can be searched from
+// several threads while the original is being updated.
+class TrigramIndex
+{
+public:
+    static const int kMinQueryLength = 3;
+
+    void add(quint32 id, const QByteArray &foldedName);
+    void clear();
+
+    // Sorted, unique ids that may contain needle; needle must be at least kMinQueryLength bytes
+    QVector<quint32> candidates(const QByteArray &needle) const;
+    // Sorts the lists that got ids out of order, so lookups need not sort copies
+    void sortPending() const;
+
+    qint64 memoryBytes() const;
+
+private:
+    static quint32 key(const char *bytes)
+    {
+        return quint32(quint8(bytes[0])) << 16 | quint32(quint8(bytes[1])) << 8 | quint8(bytes[2]);
+    }
+    QVector<quint32> postings(quint32 trigram) const;
+
+    // Lists that got an id out of order are sorted by sortPending()
+    mutable QHash<quint32, QVector<quint32>> lists;
+    mutable QSet<quint32> unsortedLists;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,285 @@
+#include "weldcatalog.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QStringList>
+#include <QtEndian>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <io.h>
+#endif
+
+namespace {
+const quint32 kCatalogMagic = 0x574c4443;  // "WLDC"
+const quint32 kCatalogVersion = 2;            // 2: records carry their sidecar mtime
+const quint32 kJournalMagic = 0x4a444c57;  // "WLDJ" as little endian bytes
+const int kJournalStartSize = 8;           // magic + kCatalogVersion, little endian
+const int kJournalHeaderSize = 8;          // payload length + CRC-32, little endian
+const int kMinCompactEntries = 1000;
+
+quint32 crc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data)
+        crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+}
+
+WeldCatalog::WeldCatalog(const QString &directory)
+    : snapshotPath(directory + "/catalog.bin")
+    , journalPath(directory + "/catalog.journal")
+{
+    QDir().mkpath(directory);
+}
+
+WeldCatalog::~WeldCatalog()
+{
+    journal.close();
+}
+
+bool WeldCatalog::load()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    bool snapshotOk = loadSnapshot();
+    replayJournal();
+    openJournal();
+
+    qDebug() << "Catalog loaded" << entries.size() << "records," << journalEntries
+             << "journal entries in" << timer.elapsed() << "ms";
+    return snapshotOk;
+}
+
+bool WeldCatalog::loadSnapshot()
+{
+    QFile file(snapshotPath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kCatalogMagic || version != kCatalogVersion) {
+        qDebug() << "Catalog snapshot has an unknown format, rebuilding";
+        return false;
+    }
+
+    entries.reserve(int(qMin<quint32>(count, 1u << 20)));
+    for (quint32 i = 0; i < count; ++i) {
+        WeldRecord record;
+        in >> record;
+        if (in.status() != QDataStream::Ok) {
+            qDebug() << "Catalog snapshot is truncated, rebuilding";
+            entries = FolderSnapshot();
+            return false;
+        }
+        entries.insert(record);
+    }
+    return true;
+}
+
+void WeldCatalog::replayJournal()
+{
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadWrite))
+        return;
+
+    const QByteArray data = file.readAll();
+    if (data.isEmpty())
+        return;
+    // Entries hold records as the snapshot does, so they share its version
+    const uchar *start = reinterpret_cast<const uchar *>(data.constData());
+    if (data.size() < kJournalStartSize || qFromLittleEndian<quint32>(start) != kJournalMagic
+            || qFromLittleEndian<quint32>(start + 4) != kCatalogVersion) {
+        qDebug() << "Catalog journal has an unknown format, discarding it";
+        file.resize(0);
+        return;
+    }
+
+    int pos = kJournalStartSize;
+    while (pos + kJournalHeaderSize <= data.size()) {
+        const uchar *header = reinterpret_cast<const uchar *>(data.constData() + pos);
+        quint32 length = qFromLittleEndian<quint32>(header);
+        quint32 checksum = qFromLittleEndian<quint32>(header + 4);
+        if (length > quint32(data.size() - pos - kJournalHeaderSize))
+            break;
+
+        QByteArray payload = data.mid(pos + kJournalHeaderSize, int(length));
+        if (crc32(payload) != checksum)
+            break;
+
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_5_12);
+        quint8 op = 0;
+        WeldRecord record;
+        in >> op >> record;
+        if (op == Upsert)
+            entries.insert(record);
+        else if (op == Remove)
+            entries.remove(record.fileName);
+
+        pos += kJournalHeaderSize + int(length);
+        ++journalEntries;
+    }
+
+    // Drop a torn tail so new entries are appended after the last good one
+    if (pos < data.size()) {
+        qDebug() << "Catalog journal: discarding" << data.size() - pos << "bytes after the last complete entry";
+        file.resize(pos);
+    }
+}
+
+bool WeldCatalog::openJournal()
+{
+    journal.setFileName(journalPath);
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+    if (journal.size() == 0)
+        startJournal();
+    return true;
+}
+
+void WeldCatalog::startJournal()
+{
+    uchar start[kJournalStartSize];
+    qToLittleEndian<quint32>(kJournalMagic, start);
+    qToLittleEndian<quint32>(kCatalogVersion, start + 4);
+    journal.write(reinterpret_cast<const char *>(start), kJournalStartSize);
+    syncJournal();
+}
+
+// Written through to the disk before returning, so a power cut keeps every
+// change made so far
+void WeldCatalog::syncJournal()
+{
+    journal.flush();
+#if defined(Q_OS_UNIX)
+    ::fsync(journal.handle());
+#elif defined(Q_OS_WIN)
+    ::_commit(journal.handle());
+#endif
+}
+
+void WeldCatalog::appendJournal(JournalOp op, const WeldRecord &record)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << quint8(op) << record;
+
+    uchar header[kJournalHeaderSize];
+    qToLittleEndian<quint32>(quint32(payload.size()), header);
+    qToLittleEndian<quint32>(crc32(payload), header + 4);
+
+    journal.write(reinterpret_cast<const char *>(header), kJournalHeaderSize);
+    journal.write(payload);
+    ++journalEntries;
+}
+
+int WeldCatalog::reconcile(const FolderSnapshot &current)
+{
+    const QHash<QString, WeldRecord> &known = entries.records();
+    const QHash<QString, WeldRecord> &found = current.records();
+
+    QStringList removed;
+    for (auto it = known.constBegin(); it != known.constEnd(); ++it) {
+        if (!found.contains(it.key()))
+            removed.append(it.key());
+    }
+
+    QVector<WeldRecord> upserted;
+    for (auto it = found.constBegin(); it != found.constEnd(); ++it) {
+        auto old = known.constFind(it.key());
+        if (old == known.constEnd() || !old->sameFileAs(it.value())
+            || old->defectType != it.value().defectType)
+            upserted.append(it.value());
+    }
+
+    for (const QString &name : removed) {
+        WeldRecord record;
+        record.fileName = name;
+        appendJournal(Remove, record);
+        entries.remove(name);
+    }
+    for (const WeldRecord &record : upserted) {
+        appendJournal(Upsert, record);
+        entries.insert(record);
+    }
+    syncJournal();
+    compactIfJournalLarge();
+
+    return removed.size() + upserted.size();
+}
+
+void WeldCatalog::upsert(const WeldRecord &record)
+{
+    appendJournal(Upsert, record);
+    syncJournal();
+    entries.insert(record);
+    compactIfJournalLarge();
+}
+
+void WeldCatalog::remove(const QString &fileName)
+{
+    if (!entries.records().contains(fileName))
+        return;
+    WeldRecord record;
+    record.fileName = fileName;
+    appendJournal(Remove, record);
+    syncJournal();
+    entries.remove(fileName);
+    compactIfJournalLarge();
+}
+
+void WeldCatalog::compactIfJournalLarge()
+{
+    if (journalEntries > qMax(kMinCompactEntries, entries.size() / 4))
+        compact();
+}
+
+bool WeldCatalog::compact()
+{
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kCatalogMagic << kCatalogVersion << quint32(entries.size());
+    for (const WeldRecord &record : entries.records())
+        out << record;
+
+    // The journal is only emptied once the new snapshot is safely in place.
+    // Replaying it over that snapshot again would be harmless anyway.
+    if (!file.commit()) {
+        qDebug() << "Catalog snapshot could not be written:" << file.errorString();
+        return false;
+    }
+    journal.resize(0);
+    journalEntries = 0;
+    startJournal();
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef WELDCATALOG_H
+#define WELDCATALOG_H
+
+#include <QFile>
+#include <QString>
+
+#include "foldersnapshot.h"
+#include "weldrecord.h"
+
+// Persistent record of every weld in the data folder.
+// catalog.bin holds a full snapshot; catalog.journal holds the changes made
+// since, after a magic and version word, one checksummed entry each. Each
+// change is synced to the disk before it returns. Loading replays the journal
+// over the snapshot and stops at the first torn entry, so a crash or power cut
+// loses at most the change that was being written.
+class WeldCatalog
+{
+public:
+    explicit WeldCatalog(const QString &directory);
+    ~WeldCatalog();
+
+    bool load();
+    // Journals the differences between the catalog and a fresh folder scan
+    int reconcile(const FolderSnapshot &current);
+    // Single changes reported by the file watcher
+    void upsert(const WeldRecord &record);
+    void remove(const QString &fileName);
+    // Rewrites catalog.bin and empties the journal
+    bool compact();
+
+    const FolderSnapshot &records() const { return entries; }
+
+private:
+    enum JournalOp : quint8 { Upsert = 1, Remove = 2 };
+
+    bool loadSnapshot();
+    void replayJournal();
+    bool openJournal();
+    void startJournal();
+    void syncJournal();
+    void appendJournal(JournalOp op, const WeldRecord &record);
+    void compactIfJournalLarge();
+
+    QString snapshotPath;
+    QString journalPath;
+    QFile journal;
+    FolderSnapshot entries;
+    int journalEntries = 0;
+};
+
+#endif // WELDCATALOG_H
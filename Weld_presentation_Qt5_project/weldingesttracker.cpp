@@ -0,0 +1,66 @@
+#include "weldingesttracker.h"
+
+#include <QFileInfo>
+
+#include "weldrecord.h"
+
+WeldIngestTracker::WeldIngestTracker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool WeldIngestTracker::isImagePath(const QString &path)
+{
+    return path.endsWith(".jpg", Qt::CaseInsensitive) || path.endsWith(".jpeg", Qt::CaseInsensitive);
+}
+
+void WeldIngestTracker::fileStarted(const QString &path)
+{
+    filesBeingWritten.insert(path);
+}
+
+void WeldIngestTracker::fileWritten(const QString &path)
+{
+    filesBeingWritten.remove(path);
+
+    if (isImagePath(path)) {
+        checkImage(path);
+    } else if (path.endsWith(".txt", Qt::CaseInsensitive)) {
+        QString imagePath = imageForSidecar(path);
+        if (!imagePath.isEmpty())
+            checkImage(imagePath);
+    }
+}
+
+void WeldIngestTracker::fileRemoved(const QString &path)
+{
+    filesBeingWritten.remove(path);
+    if (isImagePath(path))
+        emit recordRemoved(path);
+}
+
+bool WeldIngestTracker::isComplete(const QString &path) const
+{
+    return !filesBeingWritten.contains(path) && QFileInfo::exists(path);
+}
+
+void WeldIngestTracker::checkImage(const QString &imagePath)
+{
+    if (isComplete(imagePath) && isComplete(sidecarPathFor(imagePath)))
+        emit recordReady(imagePath);
+}
+
+// "<name>.jpg.txt" belongs to "<name>.jpg"; "<name>.txt" to whichever image of that name exists
+QString WeldIngestTracker::imageForSidecar(const QString &sidecarPath) const
+{
+    QString withoutTxt = sidecarPath.left(sidecarPath.size() - 4);
+    if (isImagePath(withoutTxt))
+        return withoutTxt;
+
+    for (const char *extension : {".jpg", ".JPG", ".jpeg", ".JPEG"}) {
+        QString imagePath = withoutTxt + extension;
+        if (QFileInfo::exists(imagePath))
+            return imagePath;
+    }
+    return QString();
+}
@@ -0,0 +1,36 @@
+#ifndef WELDINGESTTRACKER_H
+#define WELDINGESTTRACKER_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+// Pairs weld images with their .txt sidecars as files arrive.
+// A record is ready once both files exist and neither is still being written.
+class WeldIngestTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WeldIngestTracker(QObject *parent = nullptr);
+
+    static bool isImagePath(const QString &path);
+
+public slots:
+    void fileStarted(const QString &path);
+    void fileWritten(const QString &path);
+    void fileRemoved(const QString &path);
+
+signals:
+    void recordReady(const QString &imagePath);
+    void recordRemoved(const QString &imagePath);
+
+private:
+    bool isComplete(const QString &path) const;
+    void checkImage(const QString &imagePath);
+    QString imageForSidecar(const QString &sidecarPath) const;
+
+    QSet<QString> filesBeingWritten;
+};
+
+#endif // WELDINGESTTRACKER_H
@@ -0,0 +1,291 @@
+#include "weldlistmodel.h"
+
+#include <algorithm>
+
+#include "thumbnailloader.h"
+
+namespace {
+const int kFetchChunk = 256;
+// Past this many separate runs of removed rows, a reset is cheaper than announcing each
+const int kMaxRemovedRanges = 32;
+}
+
+WeldListModel::WeldListModel(const WeldRecordTable *table, QObject *parent)
+    : QAbstractListModel(parent)
+    , table(table)
+{
+}
+
+void WeldListModel::setThumbnailLoader(ThumbnailLoader *loader)
+{
+    thumbnails = loader;
+    connect(thumbnails, &ThumbnailLoader::thumbnailReady, this, &WeldListModel::thumbnailReady);
+}
+
+int WeldListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return showsEmptyText() ? 1 : fetchedRows;
+}
+
+QVariant WeldListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+    if (showsEmptyText())
+        return role == Qt::DisplayRole ? QVariant(emptyText) : QVariant();
+    if (index.row() >= fetchedRows)
+        return QVariant();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return table->baseName(rows.at(index.row()));
+    case RelativePathRole:
+        return table->fileName(rows.at(index.row()));
+    case Qt::DecorationRole:
+        // Only rows on screen are asked for, which is what queues their thumbnails.
+        // Until one is ready the row holds a blank of the same size, so the
+        // height the view measured once for every row has room for it.
+        if (thumbnails) {
+            quint32 id = rows.at(index.row());
+            QPixmap pixmap = thumbnails->thumbnail(id, table->fileName(id), table->mtimeMs(id));
+            return pixmap.isNull() ? thumbnails->placeholder() : pixmap;
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags WeldListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid() || showsEmptyText())
+        return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemNeverHasChildren;
+}
+
+bool WeldListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && fetchedRows < rows.size();
+}
+
+void WeldListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid())
+        return;
+    int count = qMin(kFetchChunk, rows.size() - fetchedRows);
+    if (count <= 0)
+        return;
+    beginInsertRows(QModelIndex(), fetchedRows, fetchedRows + count - 1);
+    fetchedRows += count;
+    endInsertRows();
+}
+
+void WeldListModel::thumbnailReady(quint32 id)
+{
+    if (!table->isAlive(id))
+        return;
+    int row = findRow(id);
+    if (row >= 0 && row < fetchedRows)
+        emit dataChanged(index(row), index(row), {Qt::DecorationRole});
+}
+
+void WeldListModel::showAllRecords()
+{
+    beginResetModel();
+    rows = table->sortedView(WeldRecordTable::ByNewest);
+    orderKey = WeldRecordTable::ByNewest;
+    orderReversed = false;
+    ranked = false;
+    fetchedRows = qMin(kFetchChunk, rows.size());
+    endResetModel();
+}
+
+void WeldListModel::showRecords(const QVector<quint32> &ids, WeldRecordTable::SortKey key, bool reversed)
+{
+    bool extends = !ranked && key == orderKey && reversed == orderReversed && fetchedRows > 0
+                   && fetchedRows <= ids.size() && std::equal(rows.constBegin(), rows.constBegin() + fetchedRows, ids.constBegin());
+    if (extends) {
+        // Rows past the fetched ones are not known to the view yet
+        rows = ids;
+        if (fetchedRows < kFetchChunk)
+            fetchMore(QModelIndex());
+        return;
+    }
+
+    beginResetModel();
+    rows = ids;
+    orderKey = key;
+    orderReversed = reversed;
+    ranked = false;
+    fetchedRows = qMin(kFetchChunk, rows.size());
+    endResetModel();
+}
+
+void WeldListModel::showRankedRecords(const QVector<quint32> &ids)
+{
+    beginResetModel();
+    rows = ids;
+    ranked = true;
+    fetchedRows = qMin(kFetchChunk, rows.size());
+    endResetModel();
+}
+
+void WeldListModel::recordsInserted(const QVector<quint32> &ids)
+{
+    if (ids.isEmpty())
+        return;
+
+    // Leaving the placeholder row is a reset; everything can go in silently
+    if (showsEmptyText()) {
+        beginResetModel();
+        for (quint32 id : ids)
+            rows.insert(insertionRow(id), id);
+        fetchedRows = qMin(kFetchChunk, rows.size());
+        endResetModel();
+        return;
+    }
+
+    // A large batch lands mostly past the fetched rows; those go in silently and
+    // only what falls inside the range the view already knows is announced
+    bool bulk = ids.size() > 1;
+    for (quint32 id : ids)
+        insertRow(insertionRow(id), id, bulk);
+
+    if (bulk && fetchedRows < kFetchChunk)
+        fetchMore(QModelIndex());
+}
+
+void WeldListModel::recordAboutToBeRemoved(quint32 id)
+{
+    int row = findRow(id);
+    if (row < 0)
+        return;
+
+    if (row >= fetchedRows) {
+        rows.remove(row);
+    } else if (rows.size() == 1 && !emptyText.isEmpty()) {
+        beginResetModel();
+        rows.remove(row);
+        fetchedRows = 0;
+        endResetModel();
+    } else {
+        beginRemoveRows(QModelIndex(), row, row);
+        rows.remove(row);
+        --fetchedRows;
+        endRemoveRows();
+    }
+}
+
+void WeldListModel::recordsAboutToBeRemoved(const QSet<quint32> &ids)
+{
+    if (ids.isEmpty())
+        return;
+    auto removing = [&ids](quint32 id) { return ids.contains(id); };
+
+    // Rows the view has not fetched yet go in one pass, unannounced
+    rows.erase(std::remove_if(rows.begin() + fetchedRows, rows.end(), removing), rows.end());
+
+    QVector<QPair<int, int>> ranges;  // first and last row of each run
+    int removed = 0;
+    for (int row = 0; row < fetchedRows; ++row) {
+        if (!removing(rows.at(row)))
+            continue;
+        if (!ranges.isEmpty() && ranges.last().second == row - 1)
+            ranges.last().second = row;
+        else
+            ranges.append(qMakePair(row, row));
+        ++removed;
+    }
+    if (ranges.isEmpty())
+        return;
+
+    // Emptying the list shows the placeholder row, which is a reset too
+    if (ranges.size() > kMaxRemovedRanges || (removed == rows.size() && !emptyText.isEmpty())) {
+        beginResetModel();
+        rows.erase(std::remove_if(rows.begin(), rows.begin() + fetchedRows, removing), rows.begin() + fetchedRows);
+        fetchedRows -= removed;
+        endResetModel();
+        return;
+    }
+
+    // Last run first, so the rows of the others do not move
+    for (int i = ranges.size() - 1; i >= 0; --i) {
+        beginRemoveRows(QModelIndex(), ranges.at(i).first, ranges.at(i).second);
+        rows.erase(rows.begin() + ranges.at(i).first, rows.begin() + ranges.at(i).second + 1);
+        fetchedRows -= ranges.at(i).second - ranges.at(i).first + 1;
+        endRemoveRows();
+    }
+}
+
+void WeldListModel::setEmptyText(const QString &text)
+{
+    if (text == emptyText)
+        return;
+    bool visible = rows.isEmpty();
+    if (visible)
+        beginResetModel();
+    emptyText = text;
+    if (visible)
+        endResetModel();
+}
+
+int WeldListModel::rowOf(quint32 id)
+{
+    int row = findRow(id);
+    if (row >= fetchedRows) {
+        beginInsertRows(QModelIndex(), fetchedRows, row);
+        fetchedRows = row + 1;
+        endInsertRows();
+    }
+    return row;
+}
+
+qint64 WeldListModel::memoryBytes() const
+{
+    return qint64(rows.capacity()) * qint64(sizeof(quint32));
+}
+
+// First row holding a record that sorts after this one in the list's order
+int WeldListModel::insertionRow(quint32 id) const
+{
+    if (ranked)
+        return rows.size();
+
+    // Equal keys go by id, as in the table's sorted views
+    auto position = std::upper_bound(rows.constBegin(), rows.constEnd(), id, [this](quint32 inserted, quint32 other) {
+        return orderReversed ? table->sortsBefore(orderKey, other, inserted)
+                             : table->sortsBefore(orderKey, inserted, other);
+    });
+    return int(position - rows.constBegin());
+}
+
+int WeldListModel::findRow(quint32 id) const
+{
+    if (ranked)
+        return rows.indexOf(id);
+
+    const quint64 key = table->sortKey(orderKey, id);
+    for (int row = insertionRow(id) - 1;
+         row >= 0 && table->sortKey(orderKey, rows.at(row)) == key; --row) {
+        if (rows.at(row) == id)
+            return row;
+    }
+    return -1;
+}
+
+void WeldListModel::insertRow(int row, quint32 id, bool bulk)
+{
+    // Rows past the fetched range are not known to the view yet. A single new
+    // row right after a fully fetched list is shown straight away.
+    bool visible = row < fetchedRows || (!bulk && row == fetchedRows && fetchedRows == rows.size());
+    if (!visible) {
+        rows.insert(row, id);
+        return;
+    }
+    beginInsertRows(QModelIndex(), row, row);
+    rows.insert(row, id);
+    ++fetchedRows;
+    endInsertRows();
+}
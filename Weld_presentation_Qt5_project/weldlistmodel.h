@@ -0,0 +1,77 @@
+#ifndef WELDLISTMODEL_H
+#define WELDLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include "weldrecordtable.h"
+
+class ThumbnailLoader;
+
+// weldImageList rows as ids into the record table, 4 bytes per row.
+// The model shows either the whole table newest first, or the records
+// matching a search in the order the search asked for. Rows are handed to the view in chunks through
+// canFetchMore()/fetchMore(), so a huge folder does not lay out all at once.
+// With a ThumbnailLoader set, rows carry a thumbnail as their decoration once it is made.
+class WeldListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles { RelativePathRole = Qt::UserRole };
+
+    explicit WeldListModel(const WeldRecordTable *table, QObject *parent = nullptr);
+
+    void setThumbnailLoader(ThumbnailLoader *loader);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    void showAllRecords();
+    // ids already in order of the key, or its reverse. Rows the view already
+    // has stay put when ids start with them, so a search can show its first
+    // results and fill in the rest later without the list jumping.
+    void showRecords(const QVector<quint32> &ids,
+                     WeldRecordTable::SortKey key = WeldRecordTable::ByNewest, bool reversed = false);
+    // ids in an order of their own (e.g. by relevance); records inserted later go at the end
+    void showRankedRecords(const QVector<quint32> &ids);
+
+    // Keep the rows in step with the table: call after inserting with the new
+    // records that belong in the list, and before removing
+    void recordsInserted(const QVector<quint32> &ids);
+    void recordAboutToBeRemoved(quint32 id);
+    void recordsAboutToBeRemoved(const QSet<quint32> &ids);
+
+    // Shown as a single disabled row while the list is empty
+    void setEmptyText(const QString &text);
+
+    int recordCount() const { return rows.size(); }
+    quint32 idAt(int row) const { return rows.at(row); }
+    bool containsRecord(quint32 id) const { return findRow(id) >= 0; }
+    // Row of a record, fetching rows up to it if needed; -1 if absent
+    int rowOf(quint32 id);
+    qint64 memoryBytes() const;
+
+private:
+    void thumbnailReady(quint32 id);
+    int insertionRow(quint32 id) const;
+    int findRow(quint32 id) const;
+    void insertRow(int row, quint32 id, bool bulk);
+    bool showsEmptyText() const { return rows.isEmpty() && !emptyText.isEmpty(); }
+
+    const WeldRecordTable *table;
+    ThumbnailLoader *thumbnails = nullptr;
+    QVector<quint32> rows;
+    WeldRecordTable::SortKey orderKey = WeldRecordTable::ByNewest;
+    bool orderReversed = false;
+    bool ranked = false;
+    int fetchedRows = 0;
+    QString emptyText;
+};
+
+#endif // WELDLISTMODEL_H
@@ -0,0 +1,218 @@
+#include "weldquery.h"
+
+#include <QCache>
+#include <QDate>
+#include <QDateTime>
+#include <QStringList>
+
+namespace {
+
+const int kDefaultSerialDistance = 2;
+const int kMaxSerialDistance = 4;
+// Numbers shorter than this are too ambiguous to correct
+const int kMinFuzzyLength = 6;
+const int kCompiledPatterns = 64;
+
+// Splits on whitespace, keeping double-quoted runs together
+QStringList splitQuery(const QString &input)
+{
+    QStringList words;
+    QString current;
+    bool quoted = false;
+    for (QChar c : input) {
+        if (c == '"')
+            quoted = !quoted;
+        if (c.isSpace() && !quoted) {
+            if (!current.isEmpty())
+                words.append(current);
+            current.clear();
+        } else {
+            current.append(c);
+        }
+    }
+    if (!current.isEmpty())
+        words.append(current);
+    return words;
+}
+
+QString unquote(const QString &value)
+{
+    if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"'))
+        return value.mid(1, value.size() - 2);
+    return value;
+}
+
+// The search box is parsed again on every keystroke, mostly with the same
+// patterns; each is compiled and JIT-optimized once. Only called from the
+// GUI thread. The compiled pattern is shared with the copies handed out.
+QRegularExpression compiledPattern(const QString &pattern)
+{
+    static QCache<QString, QRegularExpression> cache(kCompiledPatterns);
+    if (QRegularExpression *cached = cache.object(pattern))
+        return *cached;
+
+    QRegularExpression *regex = new QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption);
+    regex->optimize();
+    QRegularExpression compiled = *regex;
+    cache.insert(pattern, regex);
+    return compiled;
+}
+
+WeldQuery::FieldPattern parsePattern(const QString &value)
+{
+    WeldQuery::FieldPattern pattern;
+    int wildcards = value.count('*') + value.count('?');
+    if (wildcards == 1 && value.endsWith('*')) {
+        pattern.value = value.left(value.size() - 1);
+        pattern.prefix = true;
+    } else {
+        pattern.value = value;
+        if (wildcards > 0) {
+            pattern.wildcard = compiledPattern(QRegularExpression::wildcardToRegularExpression(value));
+        }
+    }
+    return pattern;
+}
+
+// Local time at the start of a day. Not always midnight, and days around a
+// DST change are 23 or 25 hours long.
+qint64 startOfDay(const QDate &date)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return date.startOfDay().toMSecsSinceEpoch();
+#else
+    return QDateTime(date, QTime(0, 0)).toMSecsSinceEpoch();
+#endif
+}
+
+}  // namespace
+
+bool WeldQuery::FieldPattern::matches(const QString &field) const
+{
+    if (isWildcard())
+        return wildcard.match(field).hasMatch();
+    if (prefix)
+        return field.startsWith(value, Qt::CaseInsensitive);
+    return field.compare(value, Qt::CaseInsensitive) == 0;
+}
+
+bool WeldQuery::FieldPattern::narrows(const FieldPattern &broader) const
+{
+    if (broader.isEmpty())
+        return true;
+    if (value.compare(broader.value, Qt::CaseInsensitive) == 0 && prefix == broader.prefix)
+        return true;
+    if (!broader.prefix || isEmpty())
+        return false;
+
+    // What comes before the first wildcard is where every match starts
+    int literal = 0;
+    while (literal < value.size() && value.at(literal) != '*' && value.at(literal) != '?')
+        ++literal;
+    return value.left(literal).startsWith(broader.value, Qt::CaseInsensitive);
+}
+
+WeldQuery WeldQuery::parse(const QString &input)
+{
+    WeldQuery query;
+    QStringList freeWords;
+
+    for (const QString &word : splitQuery(input)) {
+        int colon = word.indexOf(':');
+        QString field = colon > 0 ? word.left(colon).toLower() : QString();
+        QString value = unquote(word.mid(colon + 1));
+
+        if (field == "part") {
+            query.part = parsePattern(value);
+        } else if (field == "serial") {
+            int tilde = value.lastIndexOf('~');
+            if (tilde > 0) {
+                bool ok = true;
+                int distance = tilde + 1 < value.size() ? value.mid(tilde + 1).toInt(&ok) : kDefaultSerialDistance;
+                if (!ok || distance < 1 || distance > kMaxSerialDistance) {
+                    query.error = QString("Invalid edit distance \"%1\", expected 1 to %2")
+                                      .arg(value.mid(tilde + 1)).arg(kMaxSerialDistance);
+                    continue;
+                }
+                query.serial.value = value.left(tilde);
+                query.serialDistance = distance;
+            } else {
+                query.serial = parsePattern(value);
+            }
+        } else if (field == "defect") {
+            query.defect = value;
+        } else if (field == "re") {
+            query.nameRegex = compiledPattern(value);
+            if (!query.nameRegex.isValid()) {
+                query.error = QString("Invalid regular expression: %1").arg(query.nameRegex.errorString());
+                query.nameRegex = QRegularExpression();
+            }
+        } else if (field == "since" || field == "until") {
+            QDate day = QDate::fromString(value, Qt::ISODate);
+            if (!day.isValid()) {
+                query.error = QString("Invalid date \"%1\", expected YYYY-MM-DD").arg(value);
+                continue;
+            }
+            // until: includes the whole day it names
+            if (field == "since")
+                query.sinceMs = startOfDay(day);
+            else
+                query.untilMs = startOfDay(day.addDays(1));
+        } else if (field == "sort") {
+            QString order = value.toLower();
+            if (order == "newest") {
+                query.order = Newest;
+            } else if (order == "oldest") {
+                query.order = Oldest;
+            } else if (order == "part") {
+                query.order = ByPart;
+            } else if (order == "serial") {
+                query.order = BySerial;
+            } else {
+                query.error = QString("Unknown sort \"%1\", expected newest, oldest, part or serial").arg(value);
+            }
+        } else {
+            freeWords.append(word);
+        }
+    }
+
+    query.text = freeWords.join(' ');
+    return query;
+}
+
+WeldQuery WeldQuery::asFuzzySerial() const
+{
+    WeldQuery fuzzy = *this;
+    fuzzy.serialDistance = 0;
+
+    bool digitsOnly = text.size() >= kMinFuzzyLength;
+    for (QChar c : text)
+        digitsOnly = digitsOnly && c.isDigit();
+    if (!digitsOnly || !serial.isEmpty() || !error.isEmpty())
+        return fuzzy;
+
+    fuzzy.serial.value = text;
+    fuzzy.serialDistance = text.size() >= 8 ? kDefaultSerialDistance : 1;
+    fuzzy.text.clear();
+    return fuzzy;
+}
+
+bool WeldQuery::narrows(const WeldQuery &broader) const
+{
+    // An edit distance ranks records rather than just selecting them
+    if (isRanked() || broader.isRanked() || !error.isEmpty() || !broader.error.isEmpty())
+        return false;
+    if (!part.narrows(broader.part) || !serial.narrows(broader.serial))
+        return false;
+    if (!broader.defect.isEmpty() && defect.compare(broader.defect, Qt::CaseInsensitive) != 0)
+        return false;
+    if (broader.hasNameRegex() && nameRegex.pattern() != broader.nameRegex.pattern())
+        return false;
+    if (broader.sinceMs && sinceMs < broader.sinceMs)
+        return false;
+    if (broader.untilMs && (!untilMs || untilMs > broader.untilMs))
+        return false;
+
+    // Longer text, by name or as a sidecar phrase, only matches where its start does
+    return text.startsWith(broader.text, Qt::CaseInsensitive);
+}
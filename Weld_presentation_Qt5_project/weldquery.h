@@ -0,0 +1,74 @@
+#ifndef WELDQUERY_H
+#define WELDQUERY_H
+
+#include <QRegularExpression>
+#include <QString>
+#include <QtGlobal>
+
+#include "weldrecordtable.h"
+
+// A weldSearchTypeBox query, parsed once per change of the text.
+//   part:21146395 serial:1111* defect:A since:2025-06-01 until:2025-07-01 sort:serial
+//   re:"^21146(000|395)-2+"
+// Words without a field prefix are free text, matched against file names and
+// sidecar contents. re: is a regular expression matched against file names. Field values may end in '*' for a prefix match or use
+// '*' and '?' anywhere as wildcards; matching ignores case. A serial ending in
+// '~' (or '~N') also matches serials up to 2 (or N) edits away, and the
+// results are then ranked closest first.
+struct WeldQuery
+{
+    enum Order { Newest, Oldest, ByPart, BySerial };
+
+    struct FieldPattern
+    {
+        QString value;                // without the trailing '*' of a prefix
+        bool prefix = false;
+        QRegularExpression wildcard;  // set for any other use of '*' or '?'
+
+        bool isEmpty() const { return value.isEmpty(); }
+        bool isWildcard() const { return !wildcard.pattern().isEmpty(); }
+        bool matches(const QString &field) const;
+        // Every field this matches, broader matches too
+        bool narrows(const FieldPattern &broader) const;
+    };
+
+    FieldPattern part;
+    FieldPattern serial;
+    int serialDistance = 0;      // > 0 for a fuzzy serial match
+    QString defect;
+    qint64 sinceMs = 0;          // mtime range [sinceMs, untilMs); 0 means open
+    qint64 untilMs = 0;
+    QString text;
+    QRegularExpression nameRegex;  // empty pattern when there is no re:
+    Order order = Newest;
+    QString error;               // set when a field value could not be parsed
+
+    static WeldQuery parse(const QString &input);
+
+    // The table view results are ordered by, read backwards for Oldest
+    WeldRecordTable::SortKey sortKey() const
+    {
+        return order == ByPart ? WeldRecordTable::ByPart
+             : order == BySerial ? WeldRecordTable::BySerial : WeldRecordTable::ByNewest;
+    }
+    bool reversed() const { return order == Oldest; }
+    // Ranked by edit distance rather than ordered by a table view
+    bool isRanked() const { return serialDistance > 0; }
+
+    // For a query that found nothing and is just a long number: the same
+    // number as a fuzzy serial. Otherwise a query with serialDistance 0.
+    WeldQuery asFuzzySerial() const;
+
+    // Every record this query matches, broader matches too, so this query can
+    // be answered by checking just broader's results
+    bool narrows(const WeldQuery &broader) const;
+
+    bool hasNameRegex() const { return !nameRegex.pattern().isEmpty(); }
+    bool hasFilter() const
+    {
+        return !part.isEmpty() || !serial.isEmpty() || !defect.isEmpty() || sinceMs || untilMs || !text.isEmpty()
+               || hasNameRegex();
+    }
+};
+
+#endif // WELDQUERY_H
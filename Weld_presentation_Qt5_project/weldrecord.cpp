@@ -0,0 +1,65 @@
+#include "weldrecord.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+void WeldRecord::parseFileName()
+{
+    QString baseName = QFileInfo(fileName).completeBaseName();  // "21146395-111111111"
+    int dash = baseName.indexOf('-');
+    if (dash < 0) {
+        partNumber = baseName;
+        serial.clear();
+        return;
+    }
+    partNumber = baseName.left(dash);
+    serial = baseName.mid(dash + 1);
+}
+
+QDataStream &operator<<(QDataStream &out, const WeldRecord &record)
+{
+    out << record.fileName << record.partNumber << record.serial << record.defectType
+        << record.size << record.mtimeMs << record.sidecarMtimeMs;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, WeldRecord &record)
+{
+    in >> record.fileName >> record.partNumber >> record.serial >> record.defectType
+       >> record.size >> record.mtimeMs >> record.sidecarMtimeMs;
+    return in;
+}
+
+QString sidecarPathFor(const QString &imagePath)
+{
+    QString textPath = imagePath + ".txt";
+    if (QFileInfo::exists(textPath))
+        return textPath;
+
+    QFileInfo imageInfo(imagePath);
+    QString basePath = imageInfo.absolutePath() + "/" + imageInfo.completeBaseName() + ".txt";
+    return QFileInfo::exists(basePath) ? basePath : textPath;
+}
+
+QString readDefectType(const QString &sidecarPath)
+{
+    QFile file(sidecarPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (!line.startsWith("Defect type", Qt::CaseInsensitive))
+            continue;
+
+        QString value = line.mid(int(sizeof("Defect type")) - 1).trimmed();
+        if (value.startsWith('"')) {
+            int closing = value.indexOf('"', 1);
+            value = value.mid(1, closing < 0 ? -1 : closing - 1);
+        }
+        return value.trimmed();
+    }
+    return QString();
+}
@@ -0,0 +1,40 @@
+#ifndef WELDRECORD_H
+#define WELDRECORD_H
+
+#include <QDataStream>
+#include <QMetaType>
+#include <QString>
+#include <QtGlobal>
+
+// One weld image in the data folder, as seen by the last scan.
+// Images are named "<part>-<serial>.jpg"; the defect type comes from the .txt sidecar.
+struct WeldRecord
+{
+    QString fileName;
+    QString partNumber;
+    QString serial;
+    QString defectType;
+    qint64 size = 0;
+    qint64 mtimeMs = 0;
+    qint64 sidecarMtimeMs = 0;  // 0 while the image has no sidecar
+
+    // A rewritten sidecar counts as a change too: its words must be indexed again
+    bool sameFileAs(const WeldRecord &other) const
+    {
+        return size == other.size && mtimeMs == other.mtimeMs && sidecarMtimeMs == other.sidecarMtimeMs;
+    }
+
+    void parseFileName();
+};
+
+QDataStream &operator<<(QDataStream &out, const WeldRecord &record);
+QDataStream &operator>>(QDataStream &in, WeldRecord &record);
+
+// Sidecar next to an image: "<name>.jpg.txt", or "<name>.txt" if only that exists
+QString sidecarPathFor(const QString &imagePath);
+// Value of the 'Defect type "A"' line, or an empty string
+QString readDefectType(const QString &sidecarPath);
+
+Q_DECLARE_METATYPE(WeldRecord)
+
+#endif // WELDRECORD_H
@@ -0,0 +1,469 @@
+#include "weldrecordtable.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const int kRadixBits = 8;
+const int kRadixBuckets = 1 << kRadixBits;
+
+// Digit-only fields (the usual case) sort numerically; anything else sorts
+// after them by its first seven bytes.
+quint64 fieldSortKey(const char *data, int length)
+{
+    bool digitsOnly = length > 0 && length <= WeldRecordTable::kMaxNumericDigits;
+    quint64 value = 0;
+    for (int i = 0; digitsOnly && i < length; ++i) {
+        if (data[i] < '0' || data[i] > '9')
+            digitsOnly = false;
+        else
+            value = value * 10 + quint64(data[i] - '0');
+    }
+    if (digitsOnly)
+        return value;
+
+    quint64 key = 0;
+    for (int i = 0; i < 7; ++i)
+        key = (key << 8) | (i < length ? quint8(data[i]) : 0);
+    return (quint64(1) << 63) | key;
+}
+
+// Part is the text before the first '-' of the base name, serial the text after it
+void splitName(const QByteArray &name, quint16 &partStart, quint16 &partLength,
+               quint16 &serialStart, quint16 &serialLength)
+{
+    int baseStart = name.lastIndexOf('/') + 1;
+    int dot = name.lastIndexOf('.');
+    int baseEnd = dot > baseStart ? dot : name.size();
+    int dash = name.indexOf('-', baseStart);
+    if (dash < 0 || dash >= baseEnd) {
+        partStart = quint16(baseStart);
+        partLength = quint16(baseEnd - baseStart);
+        serialStart = quint16(baseEnd);
+        serialLength = 0;
+        return;
+    }
+    partStart = quint16(baseStart);
+    partLength = quint16(dash - baseStart);
+    serialStart = quint16(dash + 1);
+    serialLength = quint16(baseEnd - dash - 1);
+}
+}
+
+quint32 WeldRecordTable::insert(const WeldRecord &record)
+{
+    quint32 id = store(record);
+    for (int key = 0; key < SortKeyCount; ++key)
+        insertIntoView(SortKey(key), id);
+    return id;
+}
+
+QVector<quint32> WeldRecordTable::insertBatch(const QVector<WeldRecord> &records)
+{
+    QVector<quint32> ids;
+    ids.reserve(records.size());
+    for (const WeldRecord &record : records)
+        ids.append(store(record));
+
+    for (int k = 0; k < SortKeyCount; ++k) {
+        SortKey key = SortKey(k);
+        // The radix sort is stable, so equal keys stay in id order
+        QVector<quint32> sortedBatch = ids;
+        std::sort(sortedBatch.begin(), sortedBatch.end());
+        radixSort(key, sortedBatch);
+
+        QVector<quint32> &view = views[key];
+        QVector<quint32> merged(view.size() + sortedBatch.size());
+        std::merge(view.constBegin(), view.constEnd(), sortedBatch.constBegin(), sortedBatch.constEnd(),
+                   merged.begin(), [this, key](quint32 a, quint32 b) {
+                       return sortsBefore(key, a, b);
+                   });
+        view = merged;
+    }
+    return ids;
+}
+
+void WeldRecordTable::remove(quint32 id)
+{
+    if (!isAlive(id))
+        return;
+
+    for (int key = 0; key < SortKeyCount; ++key)
+        removeFromView(SortKey(key), id);
+
+    const QByteArray name = nameBytes(id);
+    idsByNameHash.remove(nameHash(name.constData(), name.size()), id);
+
+    wastedPoolBytes += nameLengths.at(int(id));
+    alive[int(id)] = false;
+    freeIds.append(id);
+    --liveCount;
+
+    if (wastedPoolBytes > namePool.size() / 2)
+        compactNamePool();
+}
+
+void WeldRecordTable::removeBatch(const QSet<quint32> &ids)
+{
+    QVector<bool> removing(alive.size(), false);
+    int count = 0;
+    for (quint32 id : ids) {
+        if (isAlive(id)) {
+            removing[int(id)] = true;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return;
+
+    for (QVector<quint32> &view : views) {
+        view.erase(std::remove_if(view.begin(), view.end(), [&removing](quint32 id) { return removing.at(int(id)); }),
+                   view.end());
+    }
+
+    for (quint32 id : ids) {
+        if (!isAlive(id))
+            continue;
+        const QByteArray name = nameBytes(id);
+        idsByNameHash.remove(nameHash(name.constData(), name.size()), id);
+        wastedPoolBytes += nameLengths.at(int(id));
+        alive[int(id)] = false;
+        freeIds.append(id);
+        --liveCount;
+    }
+
+    if (wastedPoolBytes > namePool.size() / 2)
+        compactNamePool();
+}
+
+void WeldRecordTable::clear()
+{
+    *this = WeldRecordTable();
+}
+
+FolderDiff WeldRecordTable::diff(const FolderSnapshot &current) const
+{
+    FolderDiff result;
+    const QHash<QString, WeldRecord> &found = current.records();
+
+    for (int i = 0; i < alive.size(); ++i) {
+        if (!alive.at(i))
+            continue;
+        auto it = found.constFind(fileName(quint32(i)));
+        if (it == found.constEnd() || !sameFile(quint32(i), it.value()))
+            result.removed.append(record(quint32(i)));
+    }
+
+    for (auto it = found.constBegin(); it != found.constEnd(); ++it) {
+        quint32 id = idOf(it.key());
+        if (id == kInvalidId || !sameFile(id, it.value()))
+            result.inserted.append(it.value());
+    }
+    return result;
+}
+
+// WeldRecord::sameFileAs() on the columns, without building the record
+bool WeldRecordTable::sameFile(quint32 id, const WeldRecord &record) const
+{
+    return record.size == sizes.at(int(id)) && record.mtimeMs == mtimes.at(int(id))
+           && record.sidecarMtimeMs == sidecarMtimes.at(int(id));
+}
+
+quint32 WeldRecordTable::idOf(const QString &fileName) const
+{
+    const QByteArray name = fileName.toUtf8();
+    const quint32 hash = nameHash(name.constData(), name.size());
+    for (auto it = idsByNameHash.constFind(hash); it != idsByNameHash.constEnd() && it.key() == hash; ++it) {
+        quint32 id = it.value();
+        if (nameLengths.at(int(id)) == name.size()
+            && memcmp(namePool.constData() + nameOffsets.at(int(id)), name.constData(), name.size()) == 0)
+            return id;
+    }
+    return kInvalidId;
+}
+
+QString WeldRecordTable::fileName(quint32 id) const
+{
+    return QString::fromUtf8(namePool.constData() + nameOffsets.at(int(id)), nameLengths.at(int(id)));
+}
+
+QString WeldRecordTable::baseName(quint32 id) const
+{
+    const char *name = namePool.constData() + nameOffsets.at(int(id));
+    int length = nameLengths.at(int(id));
+    int start = length;
+    while (start > 0 && name[start - 1] != '/')
+        --start;
+    return QString::fromUtf8(name + start, length - start);
+}
+
+QString WeldRecordTable::partNumber(quint32 id) const
+{
+    const Span &span = partSpans.at(int(id));
+    return QString::fromUtf8(namePool.constData() + nameOffsets.at(int(id)) + span.start, span.length);
+}
+
+QString WeldRecordTable::serial(quint32 id) const
+{
+    const Span &span = serialSpans.at(int(id));
+    return QString::fromUtf8(namePool.constData() + nameOffsets.at(int(id)) + span.start, span.length);
+}
+
+QByteArray WeldRecordTable::serialBytes(quint32 id) const
+{
+    const Span &span = serialSpans.at(int(id));
+    return QByteArray::fromRawData(namePool.constData() + nameOffsets.at(int(id)) + span.start, span.length);
+}
+
+QString WeldRecordTable::defectType(quint32 id) const
+{
+    return defectNames.at(defectCodes.at(int(id)));
+}
+
+WeldRecord WeldRecordTable::record(quint32 id) const
+{
+    WeldRecord record;
+    record.fileName = fileName(id);
+    record.partNumber = partNumber(id);
+    record.serial = serial(id);
+    record.defectType = defectType(id);
+    record.size = size(id);
+    record.mtimeMs = mtimeMs(id);
+    record.sidecarMtimeMs = sidecarMtimeMs(id);
+    return record;
+}
+
+quint64 WeldRecordTable::sortKey(SortKey key, quint32 id) const
+{
+    switch (key) {
+    case ByNewest:
+        return newestKey(mtimes.at(int(id)));
+    case ByPart:
+        return partKeys.at(int(id));
+    case BySerial:
+        return serialKeys.at(int(id));
+    default:
+        return 0;
+    }
+}
+
+bool WeldRecordTable::sortsBefore(SortKey key, quint32 a, quint32 b) const
+{
+    const quint64 keyA = sortKey(key, a);
+    const quint64 keyB = sortKey(key, b);
+    return keyA < keyB || (keyA == keyB && a < b);
+}
+
+quint64 WeldRecordTable::fieldKey(const QString &field)
+{
+    const QByteArray bytes = field.toUtf8();
+    return fieldSortKey(bytes.constData(), bytes.size());
+}
+
+quint64 WeldRecordTable::newestKey(qint64 mtimeMs)
+{
+    // Flip the sign bit so the signed mtime orders as unsigned, then invert for newest first
+    return ~(quint64(mtimeMs) ^ (quint64(1) << 63));
+}
+
+QVector<quint32> WeldRecordTable::idsInKeyRange(SortKey key, quint64 low, quint64 high) const
+{
+    QPair<int, int> range = keyRange(key, low, high);
+    return views[key].mid(range.first, range.second - range.first);
+}
+
+int WeldRecordTable::countInKeyRange(SortKey key, quint64 low, quint64 high) const
+{
+    QPair<int, int> range = keyRange(key, low, high);
+    return range.second - range.first;
+}
+
+QVector<quint32> WeldRecordTable::idsWithDefect(const QString &defectType) const
+{
+    QVector<bool> wanted(defectNames.size());
+    bool any = false;
+    for (int code = 0; code < defectNames.size(); ++code) {
+        wanted[code] = defectNames.at(code).compare(defectType, Qt::CaseInsensitive) == 0;
+        any = any || wanted.at(code);
+    }
+
+    QVector<quint32> ids;
+    if (!any)
+        return ids;
+    for (int id = 0; id < defectCodes.size(); ++id) {
+        if (alive.at(id) && wanted.at(defectCodes.at(id)))
+            ids.append(quint32(id));
+    }
+    return ids;
+}
+
+qint64 WeldRecordTable::memoryBytes() const
+{
+    qint64 bytes = namePool.capacity();
+    bytes += qint64(nameOffsets.capacity()) * sizeof(quint32);
+    bytes += qint64(nameLengths.capacity()) * sizeof(quint16);
+    bytes += qint64(partSpans.capacity() + serialSpans.capacity()) * sizeof(Span);
+    bytes += qint64(mtimes.capacity() + sizes.capacity() + sidecarMtimes.capacity()) * sizeof(qint64);
+    bytes += qint64(partKeys.capacity() + serialKeys.capacity()) * sizeof(quint64);
+    bytes += qint64(defectCodes.capacity()) * sizeof(quint16);
+    bytes += alive.capacity();
+    bytes += qint64(idsByNameHash.size()) * (2 * sizeof(quint32) + sizeof(void *));
+    for (const QVector<quint32> &view : views)
+        bytes += qint64(view.capacity()) * sizeof(quint32);
+    return bytes;
+}
+
+quint32 WeldRecordTable::store(const WeldRecord &record)
+{
+    const QByteArray name = record.fileName.toUtf8().left(0xFFFF);
+
+    quint16 partStart, partLength, serialStart, serialLength;
+    splitName(name, partStart, partLength, serialStart, serialLength);
+
+    int defectCode = defectNames.indexOf(record.defectType);
+    if (defectCode < 0) {
+        defectNames.append(record.defectType);
+        defectCode = defectNames.size() - 1;
+    }
+
+    quint32 id;
+    if (!freeIds.isEmpty()) {
+        id = freeIds.takeLast();
+    } else {
+        id = quint32(alive.size());
+        nameOffsets.append(0);
+        nameLengths.append(0);
+        partSpans.append(Span());
+        serialSpans.append(Span());
+        mtimes.append(0);
+        sizes.append(0);
+        sidecarMtimes.append(0);
+        partKeys.append(0);
+        serialKeys.append(0);
+        defectCodes.append(0);
+        alive.append(false);
+    }
+
+    const int i = int(id);
+    nameOffsets[i] = quint32(namePool.size());
+    nameLengths[i] = quint16(name.size());
+    namePool.append(name);
+    partSpans[i] = Span{partStart, partLength};
+    serialSpans[i] = Span{serialStart, serialLength};
+    mtimes[i] = record.mtimeMs;
+    sizes[i] = record.size;
+    sidecarMtimes[i] = record.sidecarMtimeMs;
+    partKeys[i] = fieldSortKey(name.constData() + partStart, partLength);
+    serialKeys[i] = fieldSortKey(name.constData() + serialStart, serialLength);
+    defectCodes[i] = quint16(defectCode);
+    alive[i] = true;
+    ++liveCount;
+
+    idsByNameHash.insert(nameHash(name.constData(), name.size()), id);
+    return id;
+}
+
+// Positions [first, second) of the view holding keys in [low, high)
+QPair<int, int> WeldRecordTable::keyRange(SortKey key, quint64 low, quint64 high) const
+{
+    const QVector<quint32> &view = views[key];
+    auto byKey = [this, key](quint32 id, quint64 value) { return sortKey(key, id) < value; };
+    auto first = std::lower_bound(view.constBegin(), view.constEnd(), low, byKey);
+    auto last = std::lower_bound(first, view.constEnd(), high, byKey);
+    return qMakePair(int(first - view.constBegin()), int(last - view.constBegin()));
+}
+
+quint32 WeldRecordTable::nameHash(const char *data, int length) const
+{
+    return quint32(qHash(QByteArray::fromRawData(data, length)));
+}
+
+QByteArray WeldRecordTable::nameBytes(quint32 id) const
+{
+    return QByteArray(namePool.constData() + nameOffsets.at(int(id)), nameLengths.at(int(id)));
+}
+
+void WeldRecordTable::insertIntoView(SortKey key, quint32 id)
+{
+    QVector<quint32> &view = views[key];
+    auto position = std::lower_bound(view.begin(), view.end(), id, [this, key](quint32 other, quint32 inserted) {
+        return sortsBefore(key, other, inserted);
+    });
+    view.insert(position, id);
+}
+
+void WeldRecordTable::removeFromView(SortKey key, quint32 id)
+{
+    QVector<quint32> &view = views[key];
+    auto it = std::lower_bound(view.begin(), view.end(), id, [this, key](quint32 other, quint32 removed) {
+        return sortsBefore(key, other, removed);
+    });
+    if (it != view.end() && *it == id)
+        view.erase(it);
+}
+
+// LSD radix sort of ids by their precomputed key, one byte per pass.
+// A pass is skipped when every key has the same byte there, which is the common
+// case for the high bytes of mtimes and of numeric part numbers.
+void WeldRecordTable::radixSort(SortKey key, QVector<quint32> &ids) const
+{
+    const int n = ids.size();
+    if (n < 2)
+        return;
+
+    QVector<quint64> keys(n);
+    for (int i = 0; i < n; ++i)
+        keys[i] = sortKey(key, ids.at(i));
+
+    QVector<quint64> keyBuffer(n);
+    QVector<quint32> idBuffer(n);
+    quint64 *srcKeys = keys.data();
+    quint32 *srcIds = ids.data();
+    quint64 *dstKeys = keyBuffer.data();
+    quint32 *dstIds = idBuffer.data();
+
+    for (int shift = 0; shift < 64; shift += kRadixBits) {
+        int counts[kRadixBuckets + 1] = {};
+        for (int i = 0; i < n; ++i)
+            ++counts[((srcKeys[i] >> shift) & (kRadixBuckets - 1)) + 1];
+
+        bool singleBucket = false;
+        for (int b = 1; b <= kRadixBuckets; ++b) {
+            if (counts[b] == n) {
+                singleBucket = true;
+                break;
+            }
+        }
+        if (singleBucket)
+            continue;
+
+        for (int b = 0; b < kRadixBuckets; ++b)
+            counts[b + 1] += counts[b];
+        for (int i = 0; i < n; ++i) {
+            int bucket = int((srcKeys[i] >> shift) & (kRadixBuckets - 1));
+            int target = counts[bucket]++;
+            dstKeys[target] = srcKeys[i];
+            dstIds[target] = srcIds[i];
+        }
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcIds, dstIds);
+    }
+
+    if (srcIds != ids.data())
+        std::copy(srcIds, srcIds + n, ids.data());
+}
+
+void WeldRecordTable::compactNamePool()
+{
+    QByteArray compacted;
+    compacted.reserve(namePool.size() - int(wastedPoolBytes));
+    for (int i = 0; i < alive.size(); ++i) {
+        if (!alive.at(i))
+            continue;
+        quint32 offset = quint32(compacted.size());
+        compacted.append(namePool.constData() + nameOffsets.at(i), nameLengths.at(i));
+        nameOffsets[i] = offset;
+    }
+    namePool = compacted;
+    wastedPoolBytes = 0;
+}
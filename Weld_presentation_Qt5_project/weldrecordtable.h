@@ -0,0 +1,111 @@
+#ifndef WELDRECORDTABLE_H
+#define WELDRECORDTABLE_H
+
+#include <QByteArray>
+#include <QMultiHash>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "foldersnapshot.h"
+#include "weldrecord.h"
+
+// Every weld record in the data folder, stored column by column.
+// Names live in one UTF-8 pool; part number and serial are spans into the
+// name. Each record gets a stable id (its column index), and ids are reused
+// after a removal. Sorted views by mtime, part and serial keep 64-bit sort
+// keys precomputed, are built with a radix sort and are kept up to date as
+// records come and go.
+class WeldRecordTable
+{
+public:
+    enum SortKey { ByNewest, ByPart, BySerial, SortKeyCount };
+
+    static const quint32 kInvalidId = 0xFFFFFFFFu;
+    // Digit-only fields up to this long are keyed by their value; any such
+    // value stays below bit 63, which marks the keys of other fields
+    static const int kMaxNumericDigits = 18;
+
+    quint32 insert(const WeldRecord &record);
+    // Faster than one insert() per record: the batch is radix sorted and merged into each view
+    QVector<quint32> insertBatch(const QVector<WeldRecord> &records);
+    void remove(quint32 id);
+    // One pass over each view however many records go
+    void removeBatch(const QSet<quint32> &ids);
+    void clear();
+    // Records that differ from a fresh folder scan
+    FolderDiff diff(const FolderSnapshot &current) const;
+
+    quint32 idOf(const QString &fileName) const;
+    bool isAlive(quint32 id) const { return id < quint32(alive.size()) && alive.at(int(id)); }
+    int count() const { return liveCount; }
+
+    QString fileName(quint32 id) const;   // path relative to the data root
+    QString baseName(quint32 id) const;   // just the file name, for display
+    QString partNumber(quint32 id) const;
+    QString serial(quint32 id) const;
+    // The serial's UTF-8 bytes in the name pool, valid until the table changes
+    QByteArray serialBytes(quint32 id) const;
+    QString defectType(quint32 id) const;
+    qint64 mtimeMs(quint32 id) const { return mtimes.at(int(id)); }
+    qint64 size(quint32 id) const { return sizes.at(int(id)); }
+    qint64 sidecarMtimeMs(quint32 id) const { return sidecarMtimes.at(int(id)); }
+    WeldRecord record(quint32 id) const;
+
+    // Live ids in ascending key order, equal keys by id; ByNewest puts the newest record first
+    const QVector<quint32> &sortedView(SortKey key) const { return views[key]; }
+    quint64 sortKey(SortKey key, quint32 id) const;
+    // The order of sortedView(key)
+    bool sortsBefore(SortKey key, quint32 a, quint32 b) const;
+    // Keys a part number or serial, or an mtime, would sort under
+    static quint64 fieldKey(const QString &field);
+    static quint64 newestKey(qint64 mtimeMs);
+    // Live ids whose key lies in [low, high), in view order
+    QVector<quint32> idsInKeyRange(SortKey key, quint64 low, quint64 high) const;
+    int countInKeyRange(SortKey key, quint64 low, quint64 high) const;
+    QVector<quint32> idsWithDefect(const QString &defectType) const;  // ignoring case
+
+    qint64 memoryBytes() const;
+
+private:
+    struct Span
+    {
+        quint16 start;
+        quint16 length;
+    };
+
+    quint32 store(const WeldRecord &record);
+    bool sameFile(quint32 id, const WeldRecord &record) const;
+    quint32 nameHash(const char *data, int length) const;
+    QPair<int, int> keyRange(SortKey key, quint64 low, quint64 high) const;
+    QByteArray nameBytes(quint32 id) const;
+    void insertIntoView(SortKey key, quint32 id);
+    void removeFromView(SortKey key, quint32 id);
+    void radixSort(SortKey key, QVector<quint32> &ids) const;
+    void compactNamePool();
+
+    // Columns, indexed by record id
+    QByteArray namePool;
+    QVector<quint32> nameOffsets;
+    QVector<quint16> nameLengths;
+    QVector<Span> partSpans;
+    QVector<Span> serialSpans;
+    QVector<qint64> mtimes;
+    QVector<qint64> sizes;
+    QVector<qint64> sidecarMtimes;
+    QVector<quint64> partKeys;
+    QVector<quint64> serialKeys;
+    QVector<quint16> defectCodes;  // index into defectNames
+    QVector<bool> alive;
+
+    QStringList defectNames{QString()};
+    QMultiHash<quint32, quint32> idsByNameHash;
+    QVector<quint32> freeIds;
+    QVector<quint32> views[SortKeyCount];
+    qint64 wastedPoolBytes = 0;
+    int liveCount = 0;
+};
+
+#endif // WELDRECORDTABLE_H
@@ -0,0 +1,665 @@
+#include "weldsearchengine.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <vector>
+
+#include "editdistance.h"
+#include "parallelchunks.h"
+#include "substringscanner.h"
+
+namespace {
+const char kEntrySeparator = '\n';
+// How WeldRecordTable keys part numbers and serials
+const int kMaxNumericDigits = WeldRecordTable::kMaxNumericDigits;
+const int kKeyBytes = 7;
+// Records checked between two looks at the cancel flag
+const int kCancelCheckInterval = 4096;
+
+bool isCancelled(const WeldSearchEngine::CancelCheck &cancelled)
+{
+    return cancelled && cancelled();
+}
+
+// Index of the last character of the escape whose backslash is at i, or -1
+// for one that is unknown or cut short. \x41, \101, \cA, \p{Lu}, \g{-1} and
+// the like take arguments after their letter.
+int escapeEnd(const QString &pattern, int i)
+{
+    const int letter = i + 1;
+    if (letter >= pattern.size())
+        return -1;
+    if (!pattern.at(letter).isLetterOrNumber())
+        return letter;  // an escaped metacharacter
+
+    // The last of up to max characters from from on that accept takes, or from - 1 if none
+    auto lastOf = [&pattern](int from, int max, bool (*accept)(QChar)) {
+        int j = from;
+        while (j < pattern.size() && j - from < max && accept(pattern.at(j)))
+            ++j;
+        return j - 1;
+    };
+    auto isHex = [](QChar c) { return c.isDigit() || (c.toLower() >= 'a' && c.toLower() <= 'f'); };
+    auto isDigit = [](QChar c) { return c.isDigit(); };
+    // Index of the delimiter closing the one at open, or -1 if there is none
+    auto closing = [&pattern](int open) {
+        if (open >= pattern.size())
+            return -1;
+        switch (pattern.at(open).unicode()) {
+        case '{': return pattern.indexOf('}', open);
+        case '<': return pattern.indexOf('>', open);
+        case '\'': return pattern.indexOf('\'', open + 1);
+        default: return -1;
+        }
+    };
+
+    const int next = letter + 1;
+    const bool braced = next < pattern.size() && pattern.at(next) == '{';
+    switch (pattern.at(letter).unicode()) {
+    case 'd': case 'D': case 'w': case 'W': case 's': case 'S': case 'h': case 'H':
+    case 'v': case 'V': case 'R': case 'X': case 'b': case 'B': case 'A': case 'z':
+    case 'Z': case 'G': case 'K': case 'E': case 'a': case 'e': case 'f': case 'n':
+    case 'r': case 't':
+        return letter;
+    case 'x':  // \xhh or \x{hhhh}
+        return braced ? closing(next) : lastOf(next, 2, isHex);
+    case 'o':  // \o{ddd}
+        return braced ? closing(next) : -1;
+    case 'c':  // \cX
+        return next < pattern.size() ? next : -1;
+    case 'p': case 'P':  // \pL or \p{Lu}
+        return braced ? closing(next) : (next < pattern.size() ? next : -1);
+    case 'N':  // \N or \N{U+hh}
+        return braced ? closing(next) : letter;
+    case 'g':  // \g1, \g-1, \g{name}, \g<name>, \g'name'
+        if (next < pattern.size() && (pattern.at(next) == '-' || pattern.at(next) == '+')) {
+            int end = lastOf(next + 1, pattern.size(), isDigit);
+            return end > next ? end : -1;
+        }
+        if (next < pattern.size() && pattern.at(next).isDigit())
+            return lastOf(next, pattern.size(), isDigit);
+        return closing(next);
+    case 'k':  // \k<name>, \k'name', \k{name}
+        return closing(next);
+    default:
+        // \0dd is octal, \1 and on a back reference (or octal); all their digits go
+        if (pattern.at(letter).isDigit())
+            return lastOf(letter, pattern.size(), isDigit);
+        return -1;
+    }
+}
+
+// Index of the ')' or ']' closing the group or class opened at open, or -1
+int closingIndex(const QString &pattern, int open)
+{
+    int depth = 0;
+    for (int i = open; i < pattern.size(); ++i) {
+        QChar c = pattern.at(i);
+        if (c == '\\') {
+            i = escapeEnd(pattern, i);
+            if (i < 0)
+                return -1;
+        } else if (c == '[') {
+            // A ']' first in the class (after any '^') is a member, as are [:alpha:] names
+            int j = i + 1;
+            if (j < pattern.size() && pattern.at(j) == '^')
+                ++j;
+            if (j < pattern.size() && pattern.at(j) == ']')
+                ++j;
+            while (j < pattern.size() && pattern.at(j) != ']') {
+                if (pattern.at(j) == '\\') {
+                    j = escapeEnd(pattern, j);
+                    if (j < 0)
+                        return -1;
+                } else if (pattern.at(j) == '[' && j + 1 < pattern.size() && pattern.at(j + 1) == ':') {
+                    int end = pattern.indexOf(QLatin1String(":]"), j + 2);
+                    if (end < 0)
+                        return -1;
+                    j = end + 1;
+                }
+                ++j;
+            }
+            if (j >= pattern.size())
+                return -1;
+            if (depth == 0)
+                return j;
+            i = j;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            if (--depth == 0)
+                return i;
+        }
+    }
+    return -1;
+}
+
+// The longest run of characters every match of a regular expression has to
+// contain, or an empty string. Only the top level is looked at: groups and
+// classes end a run, an alternation there gives up. Errs towards runs that
+// are too short, never towards ones a match could lack.
+QString requiredLiteral(const QString &pattern)
+{
+    // Quoted and free-spacing patterns read differently from how they look
+    static const QRegularExpression freeSpacing("\\(\\?[a-zA-Z^-]*x");
+    if (pattern.contains(QLatin1String("\\Q")) || pattern.contains(freeSpacing))
+        return QString();
+
+    QString best;
+    QString run;
+    auto endRun = [&]() {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+    for (int i = 0; i < pattern.size(); ++i) {
+        QChar c = pattern.at(i);
+        if (c == '|') {
+            return QString();
+        } else if (c == '*' || c == '?' || c == '{') {
+            // The character before may be missing
+            run.chop(1);
+            endRun();
+            if (c == '{') {
+                i = pattern.indexOf('}', i);
+                if (i < 0)
+                    return QString();
+            }
+        } else if (c == '+' || c == '.' || c == '^' || c == '$') {
+            endRun();
+        } else if (c == '(' || c == '[') {
+            endRun();
+            i = closingIndex(pattern, i);
+            if (i < 0)
+                return QString();
+        } else if (c == '\\') {
+            int end = escapeEnd(pattern, i);
+            if (end < 0)
+                return QString();
+            // \d, \b, \x41 and the like are not their letter and arguments
+            if (end == i + 1 && !pattern.at(end).isLetterOrNumber())
+                run.append(pattern.at(end));
+            else
+                endRun();
+            i = end;
+        } else {
+            run.append(c);
+        }
+    }
+    endRun();
+    return best;
+}
+}
+
+WeldSearchEngine::WeldSearchEngine(const WeldRecordTable *table)
+    : table(table)
+{
+}
+
+void WeldSearchEngine::addRecords(const QVector<quint32> &ids)
+{
+    for (quint32 id : ids) {
+        if (entryOfId.size() <= int(id)) {
+            int oldSize = entryOfId.size();
+            entryOfId.resize(int(id) + 1);
+            std::fill(entryOfId.begin() + oldSize, entryOfId.end(), -1);
+        }
+        if (entryOfId.at(int(id)) >= 0)
+            removeRecord(id);
+
+        entryOfId[int(id)] = entryIds.size();
+        entryOffsets.append(quint32(foldedNames.size()));
+        entryIds.append(id);
+        QByteArray name = fold(table->baseName(id));
+        trigrams.add(id, name);
+        foldedNames.append(name);
+        foldedNames.append(kEntrySeparator);
+    }
+}
+
+void WeldSearchEngine::removeRecord(quint32 id)
+{
+    if (int(id) >= entryOfId.size() || entryOfId.at(int(id)) < 0)
+        return;
+
+    sidecars.remove(id);
+    entryIds[entryOfId.at(int(id))] = WeldRecordTable::kInvalidId;
+    entryOfId[int(id)] = -1;
+    ++deadEntries;
+
+    if (deadEntries > entryIds.size() / 2)
+        compact();
+}
+
+void WeldSearchEngine::clear()
+{
+    foldedNames.clear();
+    entryOffsets.clear();
+    entryIds.clear();
+    entryOfId.clear();
+    deadEntries = 0;
+    trigrams.clear();
+    sidecars.clear();
+}
+
+void WeldSearchEngine::addSidecar(quint32 id, const QStringList &words)
+{
+    if (int(id) < entryOfId.size() && entryOfId.at(int(id)) >= 0)
+        sidecars.add(id, words);
+}
+
+QVector<quint32> WeldSearchEngine::search(const WeldQuery &query, const CancelCheck &cancelled) const
+{
+    if (!query.hasFilter())
+        return orderBy(query, table->sortedView(WeldRecordTable::ByNewest));
+
+    // Of the clauses with an index behind them, the one selecting the fewest
+    // records supplies the candidates; every other clause is checked per record
+    WeldRecordTable::SortKey driverKey = WeldRecordTable::ByNewest;
+    QVector<KeyRange> driverRanges;
+    int driverCount = -1;
+    auto consider = [&](WeldRecordTable::SortKey key, const QVector<KeyRange> &ranges) {
+        if (ranges.isEmpty())
+            return;
+        int count = 0;
+        for (const KeyRange &range : ranges)
+            count += table->countInKeyRange(key, range.first, range.second);
+        if (driverCount < 0 || count < driverCount) {
+            driverKey = key;
+            driverRanges = ranges;
+            driverCount = count;
+        }
+    };
+    consider(WeldRecordTable::ByPart, fieldKeyRanges(query.part));
+    if (!query.isRanked())
+        consider(WeldRecordTable::BySerial, fieldKeyRanges(query.serial));
+    if (query.sinceMs || query.untilMs) {
+        quint64 low = query.untilMs ? WeldRecordTable::newestKey(query.untilMs) + 1 : 0;
+        quint64 high = query.sinceMs ? WeldRecordTable::newestKey(query.sinceMs) + 1 : ~quint64(0);
+        consider(WeldRecordTable::ByNewest, {KeyRange(low, high)});
+    }
+
+    TextNeedle needle = textNeedle(query.text);
+    const QByteArray regexLiteral = query.hasNameRegex() ? fold(requiredLiteral(query.nameRegex.pattern())) : QByteArray();
+    QVector<quint32> candidates;
+    bool textChecked = false;
+    if (driverCount >= 0) {
+        for (const KeyRange &range : driverRanges)
+            candidates += table->idsInKeyRange(driverKey, range.first, range.second);
+    } else if (!query.text.isEmpty()) {
+        candidates = textMatches(needle, cancelled);
+        textChecked = true;
+    } else if (regexLiteral.size() >= TrigramIndex::kMinQueryLength) {
+        // The regular expression then only runs on names holding its literal part
+        candidates = trigrams.candidates(regexLiteral);
+    } else if (!query.defect.isEmpty()) {
+        candidates = table->idsWithDefect(query.defect);
+    } else {
+        // Only wildcard or letter patterns: no index applies
+        candidates = table->sortedView(WeldRecordTable::ByNewest);
+    }
+
+    if (isCancelled(cancelled))
+        return QVector<quint32>();
+
+    if (textChecked)
+        needle.name.clear();
+    QVector<quint32> matches = parallelFilter(candidates, [&](quint32 id) {
+        return matchesQuery(id, query, needle);
+    }, cancelled);
+    if (isCancelled(cancelled))
+        return QVector<quint32>();
+
+    // Prefix ranges of different lengths can overlap
+    if (driverRanges.size() > 1) {
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+    }
+    if (query.isRanked())
+        return rankBySerialDistance(query, matches, cancelled);
+    return orderBy(query, matches);
+}
+
+QVector<quint32> WeldSearchEngine::searchWithin(const QVector<quint32> &candidates, const WeldQuery &query,
+                                                const CancelCheck &cancelled) const
+{
+    const TextNeedle needle = textNeedle(query.text);
+    QVector<quint32> matches = parallelFilter(candidates, [&](quint32 id) {
+        return matchesQuery(id, query, needle);
+    }, cancelled);
+    if (isCancelled(cancelled))
+        return QVector<quint32>();
+
+    if (query.isRanked())
+        return rankBySerialDistance(query, matches, cancelled);
+    return orderBy(query, matches);
+}
+
+// Walks the view the results are ordered by, so the matches come out in
+// their final order; a broad query fills count long before the budget
+QVector<quint32> WeldSearchEngine::firstMatches(const WeldQuery &query, int count, int budget,
+                                                const CancelCheck &cancelled) const
+{
+    QVector<quint32> matches;
+    if (query.isRanked())
+        return matches;
+
+    const QVector<quint32> &view = table->sortedView(query.sortKey());
+    const TextNeedle needle = textNeedle(query.text);
+    const int limit = qMin(budget, view.size());
+    for (int i = 0; i < limit && matches.size() < count; ++i) {
+        if (i % kCancelCheckInterval == kCancelCheckInterval - 1 && isCancelled(cancelled))
+            return QVector<quint32>();
+        quint32 id = query.reversed() ? view.at(view.size() - 1 - i) : view.at(i);
+        if (matchesQuery(id, query, needle))
+            matches.append(id);
+    }
+    return matches;
+}
+
+QVector<quint32> WeldSearchEngine::filter(const QVector<quint32> &ids, const WeldQuery &query) const
+{
+    if (!query.hasFilter())
+        return ids;
+
+    const TextNeedle needle = textNeedle(query.text);
+    const EditDistanceMatcher serialMatcher(query.serial.value.toUtf8());
+    QVector<quint32> matches;
+    for (quint32 id : ids) {
+        if (!matchesQuery(id, query, needle))
+            continue;
+        if (query.isRanked() && serialMatcher.distance(table->serialBytes(id), query.serialDistance) > query.serialDistance)
+            continue;
+        matches.append(id);
+    }
+    return matches;
+}
+
+WeldSearchEngine::TextNeedle WeldSearchEngine::textNeedle(const QString &text) const
+{
+    TextNeedle needle;
+    needle.name = fold(text);
+    if (!needle.name.isEmpty())
+        needle.sidecar = sidecars.parse(text);
+    return needle;
+}
+
+// Records whose file name or sidecar contains the text, unordered
+QVector<quint32> WeldSearchEngine::textMatches(const TextNeedle &needle, const CancelCheck &cancelled) const
+{
+    QVector<quint32> matches;
+    if (needle.name.size() < TrigramIndex::kMinQueryLength) {
+        matches = scanNames(needle.name, cancelled);
+    } else {
+        matches = parallelFilter(trigrams.candidates(needle.name), [&](quint32 id) {
+            return nameContains(id, needle.name);
+        }, cancelled);
+    }
+
+    // A record can match by name and by sidecar; keep it once
+    QVector<quint32> sidecarMatches = sidecars.search(needle.sidecar);
+    if (!sidecarMatches.isEmpty()) {
+        matches += sidecarMatches;
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+    }
+    return matches;
+}
+
+// needle.name is empty when the free text has been checked already
+bool WeldSearchEngine::matchesQuery(quint32 id, const WeldQuery &query, const TextNeedle &needle) const
+{
+    if (int(id) >= entryOfId.size() || entryOfId.at(int(id)) < 0)
+        return false;
+    if (!query.part.isEmpty() && !query.part.matches(table->partNumber(id)))
+        return false;
+    if (!query.serial.isEmpty() && !query.isRanked() && !query.serial.matches(table->serial(id)))
+        return false;
+    if (!query.defect.isEmpty() && table->defectType(id).compare(query.defect, Qt::CaseInsensitive) != 0)
+        return false;
+    if (query.sinceMs && table->mtimeMs(id) < query.sinceMs)
+        return false;
+    if (query.untilMs && table->mtimeMs(id) >= query.untilMs)
+        return false;
+    if (query.hasNameRegex() && !query.nameRegex.match(table->baseName(id)).hasMatch())
+        return false;
+    if (!needle.name.isEmpty() && !nameContains(id, needle.name) && !sidecars.matches(id, needle.sidecar))
+        return false;
+    return true;
+}
+
+// Key ranges of the table view that hold every field the pattern can match,
+// or none if the pattern has to be checked against every record
+QVector<WeldSearchEngine::KeyRange> WeldSearchEngine::fieldKeyRanges(const WeldQuery::FieldPattern &pattern)
+{
+    QVector<KeyRange> ranges;
+    const QByteArray value = pattern.value.toUtf8();
+    if (value.isEmpty() || pattern.isWildcard())
+        return ranges;
+
+    bool digitsOnly = true;
+    for (char c : value) {
+        // Non-digit fields are keyed by their raw bytes, so letters would make the range case sensitive
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || quint8(c) >= 0x80)
+            return ranges;
+        digitsOnly = digitsOnly && c >= '0' && c <= '9';
+    }
+
+    // Digit-only fields of up to 18 characters are keyed by their value
+    if (digitsOnly && value.size() <= kMaxNumericDigits) {
+        quint64 number = value.toULongLong();
+        if (!pattern.prefix) {
+            ranges.append(KeyRange(number, number + 1));
+        } else {
+            quint64 scale = 1;
+            for (int length = value.size(); length <= kMaxNumericDigits; ++length) {
+                ranges.append(KeyRange(number * scale, (number + 1) * scale));
+                scale *= 10;
+            }
+        }
+    }
+
+    // Anything else is keyed by its first seven bytes above the numeric keys
+    if (pattern.prefix || !digitsOnly || value.size() > kMaxNumericDigits) {
+        int length = qMin(value.size(), kKeyBytes);
+        quint64 key = 0;
+        for (int i = 0; i < kKeyBytes; ++i)
+            key = (key << 8) | (i < length ? quint8(value.at(i)) : 0);
+        key |= quint64(1) << 63;
+        quint64 span = pattern.prefix && length < kKeyBytes ? quint64(1) << (8 * (kKeyBytes - length)) : 1;
+        ranges.append(KeyRange(key, key + span));
+    }
+    return ranges;
+}
+
+void WeldSearchEngine::sortPendingPostings() const
+{
+    trigrams.sortPending();
+    sidecars.sortPending();
+}
+
+qint64 WeldSearchEngine::memoryBytes() const
+{
+    return foldedNames.capacity()
+           + qint64(entryOffsets.capacity() + entryIds.capacity() + entryOfId.capacity()) * qint64(sizeof(quint32))
+           + trigrams.memoryBytes() + sidecars.memoryBytes();
+}
+
+// One vectorized pass over the packed names, split by entries across the
+// thread pool; after a hit, skip to the next entry. Only names are scanned
+// this way: sidecar text is matched through SidecarIndex, whose words it
+// already holds, since a packed copy of it would double that memory.
+QVector<quint32> WeldSearchEngine::scanNames(const QByteArray &needle, const CancelCheck &cancelled) const
+{
+    const SubstringScanner scanner(needle);
+    ParallelChunks chunks(entryIds.size());
+    std::vector<QVector<quint32>> parts(size_t(chunks.chunkCount()));
+
+    chunks.run([&](int chunk, int begin, int end) {
+        QVector<quint32> &part = parts[size_t(chunk)];
+        const int limit = end < entryOffsets.size() ? int(entryOffsets.at(end)) : foldedNames.size();
+        int from = begin < entryOffsets.size() ? int(entryOffsets.at(begin)) : limit;
+        for (;;) {
+            if (isCancelled(cancelled))
+                return;
+            int hit = scanner.indexIn(foldedNames.constData(), limit, from);
+            if (hit < 0)
+                break;
+
+            auto entry = std::upper_bound(entryOffsets.constBegin() + begin, entryOffsets.constBegin() + end, quint32(hit)) - 1;
+            int index = int(entry - entryOffsets.constBegin());
+            quint32 id = entryIds.at(index);
+            if (id != WeldRecordTable::kInvalidId)
+                part.append(id);
+
+            from = index + 1 < entryOffsets.size() ? int(entryOffsets.at(index + 1)) : foldedNames.size();
+        }
+    });
+
+    QVector<quint32> matches;
+    for (const QVector<quint32> &part : parts)
+        matches += part;
+    return matches;
+}
+
+// The ids keep() accepts, checked in chunks across the thread pool and
+// joined back in their original order
+QVector<quint32> WeldSearchEngine::parallelFilter(const QVector<quint32> &ids, const std::function<bool(quint32)> &keep,
+                                                  const CancelCheck &cancelled) const
+{
+    ParallelChunks chunks(ids.size());
+    std::vector<QVector<quint32>> parts(size_t(chunks.chunkCount()));
+
+    chunks.run([&](int chunk, int begin, int end) {
+        QVector<quint32> &part = parts[size_t(chunk)];
+        for (int i = begin; i < end; ++i) {
+            if ((i - begin) % kCancelCheckInterval == kCancelCheckInterval - 1 && isCancelled(cancelled))
+                return;
+            if (keep(ids.at(i)))
+                part.append(ids.at(i));
+        }
+    });
+
+    QVector<quint32> kept;
+    for (const QVector<quint32> &part : parts)
+        kept += part;
+    return kept;
+}
+
+bool WeldSearchEngine::nameContains(quint32 id, const QByteArray &needle) const
+{
+    if (int(id) >= entryOfId.size() || entryOfId.at(int(id)) < 0)
+        return false;
+
+    int index = entryOfId.at(int(id));
+    int start = int(entryOffsets.at(index));
+    int end = index + 1 < entryOffsets.size() ? int(entryOffsets.at(index + 1)) - 1 : foldedNames.size() - 1;
+    const char *begin = foldedNames.constData() + start;
+    return std::search(begin, foldedNames.constData() + end, needle.constBegin(), needle.constEnd())
+           != foldedNames.constData() + end;
+}
+
+// Closest serials first, newest first among equally close ones
+QVector<quint32> WeldSearchEngine::rankBySerialDistance(const WeldQuery &query, const QVector<quint32> &ids,
+                                                        const CancelCheck &cancelled) const
+{
+    const EditDistanceMatcher matcher(query.serial.value.toUtf8());
+    ParallelChunks chunks(ids.size());
+    std::vector<QVector<QPair<quint64, quint32>>> parts(size_t(chunks.chunkCount()));
+
+    chunks.run([&](int chunk, int begin, int end) {
+        QVector<QPair<quint64, quint32>> &part = parts[size_t(chunk)];
+        for (int i = begin; i < end; ++i) {
+            if ((i - begin) % kCancelCheckInterval == kCancelCheckInterval - 1 && isCancelled(cancelled))
+                return;
+            quint32 id = ids.at(i);
+            int distance = matcher.distance(table->serialBytes(id), query.serialDistance);
+            if (distance > query.serialDistance)
+                continue;
+            // The distance goes in the top bits; an mtime key needs far fewer than 60
+            quint64 rank = quint64(distance) << 60 | (table->sortKey(WeldRecordTable::ByNewest, id) >> 4);
+            part.append(qMakePair(rank, id));
+        }
+    });
+    if (isCancelled(cancelled))
+        return QVector<quint32>();
+
+    QVector<QPair<quint64, quint32>> ranked;
+    for (const QVector<QPair<quint64, quint32>> &part : parts)
+        ranked += part;
+    std::sort(ranked.begin(), ranked.end());
+
+    QVector<quint32> ordered;
+    ordered.reserve(ranked.size());
+    for (const QPair<quint64, quint32> &entry : ranked)
+        ordered.append(entry.second);
+    return ordered;
+}
+
+// Small result sets are sorted directly; large ones are picked out of the
+// table's sorted view with a bitmap, which costs one pass over the view.
+QVector<quint32> WeldSearchEngine::orderBy(const WeldQuery &query, const QVector<quint32> &ids) const
+{
+    const WeldRecordTable::SortKey key = query.sortKey();
+    const QVector<quint32> &view = table->sortedView(key);
+    QVector<quint32> ordered;
+    if (ids.size() == view.size()) {
+        ordered = view;
+    } else if (ids.size() < view.size() / 64) {
+        // Same order as the view the other branches take, ties included
+        ordered = ids;
+        std::stable_sort(ordered.begin(), ordered.end(), [this, key](quint32 a, quint32 b) {
+            return table->sortsBefore(key, a, b);
+        });
+    } else {
+        QVector<quint64> bitmap((entryOfId.size() + 63) / 64, 0);
+        for (quint32 id : ids)
+            bitmap[int(id / 64)] |= quint64(1) << (id % 64);
+
+        ordered.reserve(ids.size());
+        for (quint32 id : view) {
+            if (int(id / 64) < bitmap.size() && (bitmap.at(int(id / 64)) >> (id % 64)) & 1)
+                ordered.append(id);
+        }
+    }
+
+    if (query.reversed())
+        std::reverse(ordered.begin(), ordered.end());
+    return ordered;
+}
+
+void WeldSearchEngine::compact()
+{
+    QByteArray packed;
+    QVector<quint32> offsets;
+    QVector<quint32> ids;
+    packed.reserve(foldedNames.size());
+    offsets.reserve(entryIds.size() - deadEntries);
+    ids.reserve(entryIds.size() - deadEntries);
+
+    for (int index = 0; index < entryIds.size(); ++index) {
+        quint32 id = entryIds.at(index);
+        if (id == WeldRecordTable::kInvalidId)
+            continue;
+        int start = int(entryOffsets.at(index));
+        int end = index + 1 < entryOffsets.size() ? int(entryOffsets.at(index + 1)) : foldedNames.size();
+        entryOfId[int(id)] = ids.size();
+        offsets.append(quint32(packed.size()));
+        ids.append(id);
+        packed.append(foldedNames.constData() + start, end - start);
+    }
+
+    foldedNames = packed;
+    entryOffsets = offsets;
+    entryIds = ids;
+    deadEntries = 0;
+
+    // Drop the stale ids the trigram lists have collected since the last rebuild
+    trigrams.clear();
+    for (int index = 0; index < entryIds.size(); ++index) {
+        int start = int(entryOffsets.at(index));
+        int end = index + 1 < entryOffsets.size() ? int(entryOffsets.at(index + 1)) - 1 : foldedNames.size() - 1;
+        trigrams.add(entryIds.at(index), foldedNames.mid(start, end - start));
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef WELDSEARCHENGINE_H
+#define WELDSEARCHENGINE_H
+
+#include <QByteArray>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+#include "sidecarindex.h"
+#include "trigramindex.h"
+#include "weldquery.h"
+#include "weldrecordtable.h"
+
+// Answers weldSearchTypeBox queries from memory, never from the disk.
+// Lower-cased file names are packed one after another into a single buffer.
+// Queries of three characters or more go through a trigram index and only
+// check the candidates it returns; shorter ones scan the whole buffer once.
+// Records whose sidecar text contains the query match as well. Field clauses
+// of a WeldQuery are answered from the table's sorted views; a fuzzy serial
+// is compared against every candidate with a bit-parallel edit distance.
+// Kept in step with the record table through addRecords()/removeRecord().
+//
+// search() splits the heavy passes into chunks on the global thread pool.
+// Like the table, the engine is implicitly shared data underneath, so a copy
+// of both (see SearchRunner) can be searched off the GUI thread while the
+// originals keep changing.
+class WeldSearchEngine
+{
+public:
+    using CancelCheck = std::function<bool()>;
+
+    explicit WeldSearchEngine(const WeldRecordTable *table);
+
+    // Points a copy of the engine at its copy of the table
+    void setTable(const WeldRecordTable *recordTable) { table = recordTable; }
+
+    void addRecords(const QVector<quint32> &ids);
+    void removeRecord(quint32 id);
+    void clear();
+    // Sidecars are read in the background and arrive after their records
+    void addSidecar(quint32 id, const QStringList &words);
+
+    // Matching record ids, in the order the query asks for; empty once cancelled() returns true
+    QVector<quint32> search(const WeldQuery &query, const CancelCheck &cancelled = CancelCheck()) const;
+    // Like search(), checking only candidates, which must hold every match once
+    QVector<quint32> searchWithin(const QVector<quint32> &candidates, const WeldQuery &query,
+                                  const CancelCheck &cancelled = CancelCheck()) const;
+    // The first count results of an unranked query, looking at no more than
+    // budget records; fewer if the budget runs out first, none once cancelled
+    QVector<quint32> firstMatches(const WeldQuery &query, int count, int budget,
+                                  const CancelCheck &cancelled = CancelCheck()) const;
+    // The subset of ids that match, in the order given
+    QVector<quint32> filter(const QVector<quint32> &ids, const WeldQuery &query) const;
+
+    // Finishes the index upkeep that lookups would otherwise redo on every search
+    void sortPendingPostings() const;
+
+    qint64 memoryBytes() const;
+
+private:
+    using KeyRange = QPair<quint64, quint64>;  // [low, high) in a table view
+
+    static QByteArray fold(const QString &text) { return text.toLower().toUtf8(); }
+    static QVector<KeyRange> fieldKeyRanges(const WeldQuery::FieldPattern &pattern);
+    // The free text of a query, prepared once per search rather than per record
+    struct TextNeedle
+    {
+        QByteArray name;               // folded; empty when the text was checked already
+        SidecarIndex::Query sidecar;
+    };
+    TextNeedle textNeedle(const QString &text) const;
+    QVector<quint32> textMatches(const TextNeedle &needle, const CancelCheck &cancelled) const;
+    QVector<quint32> scanNames(const QByteArray &needle, const CancelCheck &cancelled) const;
+    QVector<quint32> parallelFilter(const QVector<quint32> &ids, const std::function<bool(quint32)> &keep,
+                                    const CancelCheck &cancelled) const;
+    bool nameContains(quint32 id, const QByteArray &needle) const;
+    bool matchesQuery(quint32 id, const WeldQuery &query, const TextNeedle &needle) const;
+    QVector<quint32> orderBy(const WeldQuery &query, const QVector<quint32> &ids) const;
+    QVector<quint32> rankBySerialDistance(const WeldQuery &query, const QVector<quint32> &ids,
+                                          const CancelCheck &cancelled) const;
+    void compact();
+
+    const WeldRecordTable *table;
+
+    // One entry per added record: its folded file name followed by '\n'
+    QByteArray foldedNames;
+    QVector<quint32> entryOffsets;
+    QVector<quint32> entryIds;     // kInvalidId once the record is removed
+    QVector<int> entryOfId;        // indexed by record id, -1 if none
+    int deadEntries = 0;
+
+    // Holds stale ids of removed records until compact() rebuilds it
+    TrigramIndex trigrams;
+    SidecarIndex sidecars;
+};
+
+#endif // WELDSEARCHENGINE_H